@@ -6,6 +6,7 @@ TEMPLATE = subdirs
 cache()
 
 SUBDIRS += src \
+           src/cli \
            plugins
 TRANSLATIONS = \
     translations/copyq_af.ts \
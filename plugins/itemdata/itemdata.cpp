@@ -129,7 +129,7 @@ ItemData::ItemData(const QModelIndex &index, int maxBytes, QWidget *parent)
     setText(text);
 }
 
-void ItemData::highlight(const QRegExp &, const QFont &, const QPalette &)
+void ItemData::highlight(const TextMatcher &, const QFont &, const QPalette &)
 {
 }
 
@@ -40,7 +40,7 @@ public:
     ItemData(const QModelIndex &index, int maxBytes, QWidget *parent);
 
 protected:
-    virtual void highlight(const QRegExp &re, const QFont &highlightFont,
+    virtual void highlight(const TextMatcher &matcher, const QFont &highlightFont,
                            const QPalette &highlightPalette);
 
     virtual QWidget *createEditor(QWidget *) const { return NULL; }
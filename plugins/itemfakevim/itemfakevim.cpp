@@ -494,9 +494,9 @@ void ItemFakeVim::setCurrent(bool current)
     m_childItem->setCurrent(current);
 }
 
-void ItemFakeVim::highlight(const QRegExp &re, const QFont &highlightFont, const QPalette &highlightPalette)
+void ItemFakeVim::highlight(const TextMatcher &matcher, const QFont &highlightFont, const QPalette &highlightPalette)
 {
-    m_childItem->setHighlight(re, highlightFont, highlightPalette);
+    m_childItem->setHighlight(matcher, highlightFont, highlightPalette);
 }
 
 void ItemFakeVim::updateSize(const QSize &maximumSize, int idealWidth)
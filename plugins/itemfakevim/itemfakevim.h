@@ -38,7 +38,7 @@ public:
     virtual void setCurrent(bool current);
 
 protected:
-    virtual void highlight(const QRegExp &re, const QFont &highlightFont,
+    virtual void highlight(const TextMatcher &matcher, const QFont &highlightFont,
                            const QPalette &highlightPalette);
 
     virtual void updateSize(const QSize &maximumSize, int idealWidth);
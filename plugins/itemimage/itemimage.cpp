@@ -20,17 +20,41 @@
 #include "itemimage.h"
 #include "ui_itemimagesettings.h"
 
+#include "common/config.h"
 #include "common/contenttype.h"
 #include "item/itemeditor.h"
 
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
 #include <QHBoxLayout>
+#include <QImage>
+#include <QImageReader>
 #include <QModelIndex>
+#include <QMutex>
+#include <QMutexLocker>
 #include <QPixmap>
+#include <QRunnable>
+#include <QThreadPool>
 #include <QtPlugin>
 #include <QVariant>
 
+#ifdef Q_OS_WIN
+#   include <sys/utime.h>
+#else
+#   include <utime.h>
+#endif
+
 namespace {
 
+/// Maximum total size of cached thumbnail files.
+const qint64 maxThumbnailCacheSize = 64 * 1024 * 1024;
+
+/// Thumbnails are cached only for bigger image data (small images are decoded quickly).
+const int minThumbnailSourceSize = 64 * 1024;
+
 QString findImageFormat(const QList<QString> &formats)
 {
     // Check formats in this order.
@@ -62,29 +86,291 @@ bool getImageData(const QModelIndex &index, QByteArray *data, QString *mime)
     return true;
 }
 
-bool getPixmapFromData(const QModelIndex &index, QPixmap *pix)
+/**
+ * Return image size after scaling it down to maximum size (non-positive values are ignored).
+ */
+QSize scaledImageSize(const QSize &size, int maxWidth, int maxHeight)
 {
-    QString mime;
-    QByteArray data;
-    if ( !getImageData(index, &data, &mime) )
-        return false;
+    if ( maxWidth > 0 && size.width() > maxWidth
+         && (maxHeight <= 0 || size.width() / maxWidth > size.height() / maxHeight) )
+    {
+        return QSize( maxWidth, qMax(1, size.height() * maxWidth / size.width()) );
+    }
 
-    pix->loadFromData( data, mime.toLatin1() );
+    if ( maxHeight > 0 && size.height() > maxHeight )
+        return QSize( qMax(1, size.width() * maxHeight / size.height()), maxHeight );
 
-    return true;
+    return size;
+}
+
+/** Return image size from image header, invalid size if unknown. */
+QSize imageSize(const QByteArray &data, const QString &mime)
+{
+    QByteArray bytes = data;
+    QBuffer buffer(&bytes);
+    buffer.open(QIODevice::ReadOnly);
+    return QImageReader( &buffer, mime.mid(6).toLatin1() ).size(); // skip "image/"
+}
+
+QImage decodeImage(const QByteArray &data, const QString &mime, int maxWidth, int maxHeight)
+{
+    QByteArray bytes = data;
+    QBuffer buffer(&bytes);
+    buffer.open(QIODevice::ReadOnly);
+    QImageReader reader( &buffer, mime.mid(6).toLatin1() ); // skip "image/"
+
+    // Let image decoder scale the image if possible (faster for big JPEG images).
+    const QSize size = reader.size();
+    const QSize scaledSize = scaledImageSize(size, maxWidth, maxHeight);
+    if ( size.isValid() && scaledSize != size )
+        reader.setScaledSize(scaledSize);
+
+    QImage image = reader.read();
+    if ( !size.isValid() && !image.isNull() ) {
+        const QSize newSize = scaledImageSize(image.size(), maxWidth, maxHeight);
+        if ( newSize != image.size() )
+            image = image.scaled(newSize, Qt::IgnoreAspectRatio, Qt::FastTransformation);
+    }
+
+    return image;
+}
+
+QString thumbnailCachePath()
+{
+    return getConfigurationFilePath("_thumbnails");
+}
+
+QString thumbnailBaseName(const QByteArray &data)
+{
+    return QString::fromLatin1( QCryptographicHash::hash(data, QCryptographicHash::Sha1).toHex() );
+}
+
+/** Return path to thumbnail for image @a data scaled to given maximum size. */
+QString thumbnailFilePath(const QByteArray &data, int maxWidth, int maxHeight)
+{
+    return QString("%1/%2_%3x%4.png")
+            .arg( thumbnailCachePath(), thumbnailBaseName(data) )
+            .arg(maxWidth)
+            .arg(maxHeight);
+}
+
+QMutex &thumbnailCacheMutex()
+{
+    static QMutex mutex;
+    return mutex;
+}
+
+/// Total size of thumbnail files (computed on first save, -1 if unknown).
+qint64 &thumbnailCacheSize()
+{
+    static qint64 cacheSize = -1;
+    return cacheSize;
+}
+
+/**
+ * Load thumbnail from cache.
+ *
+ * Modification time of the file is updated so least recently used
+ * thumbnails are removed first.
+ */
+QImage loadThumbnail(const QString &filePath)
+{
+    QMutexLocker lock( &thumbnailCacheMutex() );
+
+    QImage image;
+    if ( image.load(filePath, "PNG") )
+        utime( QFile::encodeName(filePath).constData(), NULL );
+
+    return image;
+}
+
+/** Remove thumbnails (of all sizes) for image @a data. */
+void removeThumbnails(const QByteArray &data)
+{
+    QMutexLocker lock( &thumbnailCacheMutex() );
+
+    QDir dir( thumbnailCachePath() );
+    const QStringList filter( thumbnailBaseName(data) + "_*.png" );
+    foreach ( const QFileInfo &fileInfo, dir.entryInfoList(filter, QDir::Files) ) {
+        if ( QFile::remove(fileInfo.filePath()) && thumbnailCacheSize() >= 0 )
+            thumbnailCacheSize() -= fileInfo.size();
+    }
+}
+
+/**
+ * Save thumbnail to cache and remove oldest thumbnails if the cache is too big.
+ */
+void saveThumbnail(const QString &filePath, const QImage &image)
+{
+    QMutexLocker lock( &thumbnailCacheMutex() );
+
+    QDir dir( thumbnailCachePath() );
+    if ( !dir.mkpath(".") )
+        return;
+
+    // Write to temporary file first so other thread never reads partial thumbnail.
+    const QString tmpFilePath = filePath + ".tmp";
+    if ( !image.save(tmpFilePath, "PNG") )
+        return;
+    QFile::remove(filePath);
+    if ( !QFile::rename(tmpFilePath, filePath) ) {
+        QFile::remove(tmpFilePath);
+        return;
+    }
+
+    // Total size is computed only once, then it's only updated.
+    qint64 &cacheSize = thumbnailCacheSize();
+    if (cacheSize < 0) {
+        cacheSize = 0;
+        foreach ( const QFileInfo &fileInfo, dir.entryInfoList(QStringList("*.png"), QDir::Files) )
+            cacheSize += fileInfo.size();
+    } else {
+        cacheSize += QFileInfo(filePath).size();
+    }
+
+    // Remove least recently used thumbnails until cache takes at most 3/4 of maximum size.
+    if (cacheSize > maxThumbnailCacheSize) {
+        const QFileInfoList files =
+                dir.entryInfoList( QStringList("*.png"), QDir::Files, QDir::Time | QDir::Reversed );
+        foreach ( const QFileInfo &fileInfo, files ) {
+            if (cacheSize <= maxThumbnailCacheSize * 3 / 4)
+                break;
+            if ( fileInfo.filePath() != filePath && QFile::remove(fileInfo.filePath()) )
+                cacheSize -= fileInfo.size();
+        }
+    }
 }
 
 } // namespace
 
-ItemImage::ItemImage(const QPixmap &pix, const QString &imageEditor, const QString &svgEditor,
-                     QWidget *parent)
+/**
+ * Image data and scaled image size shared between widget and thread decoding the image.
+ *
+ * Decoded image is passed to receiver's setImage() slot.
+ */
+class ImageRequest
+{
+public:
+    ImageRequest(const QByteArray &data, const QString &mime, int maxWidth, int maxHeight,
+                 QObject *receiver)
+        : m_data(data)
+        , m_mime(mime)
+        , m_maxWidth(maxWidth)
+        , m_maxHeight(maxHeight)
+        , m_mutex()
+        , m_receiver(receiver)
+    {
+    }
+
+    void run()
+    {
+        // Skip decoding if widget was destroyed in the meantime (e.g. item scrolled away).
+        if ( isCanceled() )
+            return;
+
+        QImage image;
+
+        // Big images are loaded from small thumbnail files if available.
+        QString thumbnailPath;
+        if ( m_data.size() >= minThumbnailSourceSize ) {
+            thumbnailPath = thumbnailFilePath(m_data, m_maxWidth, m_maxHeight);
+            image = loadThumbnail(thumbnailPath);
+        }
+
+        if ( image.isNull() ) {
+            image = decodeImage(m_data, m_mime, m_maxWidth, m_maxHeight);
+            if ( !thumbnailPath.isEmpty() && !image.isNull() )
+                saveThumbnail(thumbnailPath, image);
+        }
+
+        QMutexLocker lock(&m_mutex);
+        if (m_receiver != NULL) {
+            QMetaObject::invokeMethod( m_receiver, "setImage", Qt::QueuedConnection,
+                                       Q_ARG(QImage, image) );
+        }
+    }
+
+    /** Don't decode image or pass the result to receiver. */
+    void cancel()
+    {
+        QMutexLocker lock(&m_mutex);
+        m_receiver = NULL;
+    }
+
+private:
+    bool isCanceled()
+    {
+        QMutexLocker lock(&m_mutex);
+        return m_receiver == NULL;
+    }
+
+    QByteArray m_data;
+    QString m_mime;
+    int m_maxWidth;
+    int m_maxHeight;
+    QMutex m_mutex;
+    QObject *m_receiver;
+};
+
+namespace {
+
+class ImageRunnable : public QRunnable
+{
+public:
+    explicit ImageRunnable(const QSharedPointer<ImageRequest> &request)
+        : m_request(request)
+    {
+    }
+
+    void run() { m_request->run(); }
+
+private:
+    QSharedPointer<ImageRequest> m_request;
+};
+
+} // namespace
+
+ItemImage::ItemImage(const QByteArray &data, const QString &mime, int maxWidth, int maxHeight,
+                     const QString &imageEditor, const QString &svgEditor, QWidget *parent)
     : QLabel(parent)
     , ItemWidget(this)
     , m_editor(imageEditor)
     , m_svgEditor(svgEditor)
+    , m_request()
 {
     setMargin(4);
-    setPixmap(pix);
+
+    // Show placeholder with correct size until image is loaded.
+    const QSize size = scaledImageSize( imageSize(data, mime), maxWidth, maxHeight );
+    if ( size.isValid() ) {
+        QPixmap placeholder(size);
+        placeholder.fill(Qt::transparent);
+        setPixmap(placeholder);
+    }
+
+    m_request = QSharedPointer<ImageRequest>(
+                new ImageRequest(data, mime, maxWidth, maxHeight, this) );
+    QThreadPool::globalInstance()->start( new ImageRunnable(m_request) );
+}
+
+ItemImage::~ItemImage()
+{
+    if (m_request)
+        m_request->cancel();
+}
+
+void ItemImage::setImage(const QImage &image)
+{
+    m_request.clear();
+
+    if ( image.isNull() )
+        return;
+
+    setPixmap( QPixmap::fromImage(image) );
+
+    // Placeholder is missing if image size is not in header.
+    // Resizing the widget notifies item view about new size.
+    adjustSize();
 }
 
 QObject *ItemImage::createExternalEditor(const QModelIndex &index, QWidget *parent) const
@@ -109,24 +395,35 @@ ItemImageLoader::~ItemImageLoader()
 
 ItemWidget *ItemImageLoader::create(const QModelIndex &index, QWidget *parent) const
 {
-    // TODO: Just check if image provided and load it in different thread.
-    QPixmap pix;
-    if ( !getPixmapFromData(index, &pix) )
+    QString mime;
+    QByteArray data;
+    if ( !getImageData(index, &data, &mime) )
         return NULL;
 
-    // scale pixmap
+    // Image is decoded and scaled in other thread.
     const int w = m_settings.value("max_image_width", 320).toInt();
     const int h = m_settings.value("max_image_height", 240).toInt();
-    if ( w > 0 && pix.width() > w && (h <= 0 || pix.width()/w > pix.height()/h) ) {
-        pix = pix.scaledToWidth(w);
-    } else if (h > 0 && pix.height() > h) {
-        pix = pix.scaledToHeight(h);
-    }
-
-    return new ItemImage(pix, m_settings.value("image_editor").toString(),
+    return new ItemImage(data, mime, w, h, m_settings.value("image_editor").toString(),
                          m_settings.value("svg_editor").toString(), parent);
 }
 
+QSize ItemImageLoader::maximumImageSize() const
+{
+    return QSize( m_settings.value("max_image_width", 320).toInt(),
+                  m_settings.value("max_image_height", 240).toInt() );
+}
+
+void ItemImageLoader::itemsAboutToBeDeleted(const QList<QModelIndex> &indexList)
+{
+    // Don't keep thumbnails of removed images.
+    foreach (const QModelIndex &index, indexList) {
+        QString mime;
+        QByteArray data;
+        if ( getImageData(index, &data, &mime) && data.size() >= minThumbnailSourceSize )
+            removeThumbnails(data);
+    }
+}
+
 QStringList ItemImageLoader::formatsToSave() const
 {
     return QStringList("image/svg+xml") << QString("image/bmp") << QString("image/png")
@@ -25,26 +25,39 @@
 
 #include <QLabel>
 #include <QScopedPointer>
+#include <QSharedPointer>
 
 namespace Ui {
 class ItemImageSettings;
 }
 
+class ImageRequest;
+
 class ItemImage : public QLabel, public ItemWidget
 {
     Q_OBJECT
 
 public:
-    ItemImage(const QPixmap &pix, const QString &imageEditor, const QString &svgEditor,
-              QWidget *parent);
+    /**
+     * Show placeholder with size of scaled image and decode the image in other thread.
+     */
+    ItemImage(const QByteArray &data, const QString &mime, int maxWidth, int maxHeight,
+              const QString &imageEditor, const QString &svgEditor, QWidget *parent);
+
+    /** Cancel decoding image if not yet finished. */
+    ~ItemImage();
 
     virtual QWidget *createEditor(QWidget *) const { return NULL; }
 
     virtual QObject *createExternalEditor(const QModelIndex &index, QWidget *parent) const;
 
+private slots:
+    void setImage(const QImage &image);
+
 private:
     QString m_editor;
     QString m_svgEditor;
+    QSharedPointer<ImageRequest> m_request;
 };
 
 class ItemImageLoader : public QObject, public ItemLoaderInterface
@@ -69,6 +82,10 @@ public:
 
     virtual QStringList formatsToSave() const;
 
+    virtual QSize maximumImageSize() const;
+
+    virtual void itemsAboutToBeDeleted(const QList<QModelIndex> &indexList);
+
     virtual QVariantMap applySettings();
 
     virtual void loadSettings(const QVariantMap &settings) { m_settings = settings; }
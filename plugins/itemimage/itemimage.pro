@@ -6,6 +6,7 @@ HEADERS += \
 SOURCES += \
     itemimage.cpp \
     ../../src/item/itemeditor.cpp \
+    ../../src/common/config.cpp \
     ../../src/common/log.cpp \
     ../../src/common/mimetypes.cpp
 FORMS   += itemimagesettings.ui
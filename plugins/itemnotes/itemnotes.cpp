@@ -117,6 +117,7 @@ ItemNotes::ItemNotes(ItemWidget *childItem, const QString &text,
 void ItemNotes::setCurrent(bool current)
 {
     ItemWidget::setCurrent(current);
+    m_childItem->setCurrent(current);
 
     if (m_timerShowToolTip == NULL)
         return;
@@ -129,42 +130,12 @@ void ItemNotes::setCurrent(bool current)
         m_timerShowToolTip->stop();
 }
 
-void ItemNotes::highlight(const QRegExp &re, const QFont &highlightFont, const QPalette &highlightPalette)
+void ItemNotes::highlight(const TextMatcher &matcher, const QFont &highlightFont, const QPalette &highlightPalette)
 {
-    m_childItem->setHighlight(re, highlightFont, highlightPalette);
+    m_childItem->setHighlight(matcher, highlightFont, highlightPalette);
 
-    if (m_notes != NULL) {
-        QList<QTextEdit::ExtraSelection> selections;
-
-        if ( !re.isEmpty() ) {
-            QTextEdit::ExtraSelection selection;
-            selection.format.setBackground( highlightPalette.base() );
-            selection.format.setForeground( highlightPalette.text() );
-            selection.format.setFont(highlightFont);
-
-            QTextCursor cur = m_notes->document()->find(re);
-            int a = cur.position();
-            while ( !cur.isNull() ) {
-                if ( cur.hasSelection() ) {
-                    selection.cursor = cur;
-                    selections.append(selection);
-                } else {
-                    cur.movePosition(QTextCursor::NextCharacter);
-                }
-                cur = m_notes->document()->find(re, cur);
-                int b = cur.position();
-                if (a == b) {
-                    cur.movePosition(QTextCursor::NextCharacter);
-                    cur = m_notes->document()->find(re, cur);
-                    b = cur.position();
-                    if (a == b) break;
-                }
-                a = b;
-            }
-        }
-
-        m_notes->setExtraSelections(selections);
-    }
+    if (m_notes != NULL)
+        highlightMatches(m_notes, matcher, highlightFont, highlightPalette);
 
     update();
 }
@@ -299,10 +270,9 @@ ItemWidget *ItemNotesLoader::transform(ItemWidget *itemWidget, const QModelIndex
             m_settings["show_tooltip"].toBool() );
 }
 
-bool ItemNotesLoader::matches(const QModelIndex &index, const QRegExp &re) const
+QString ItemNotesLoader::searchableText(const QModelIndex &index) const
 {
-    const QString text = index.data(contentType::notes).toString();
-    return re.indexIn(text) != -1;
+    return index.data(contentType::notes).toString();
 }
 
 Q_EXPORT_PLUGIN2(itemnotes, ItemNotesLoader)
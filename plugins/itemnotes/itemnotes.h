@@ -44,7 +44,7 @@ public:
     virtual void setCurrent(bool current);
 
 protected:
-    virtual void highlight(const QRegExp &re, const QFont &highlightFont,
+    virtual void highlight(const TextMatcher &matcher, const QFont &highlightFont,
                            const QPalette &highlightPalette);
 
     virtual QWidget *createEditor(QWidget *parent) const;
@@ -102,7 +102,7 @@ public:
 
     virtual ItemWidget *transform(ItemWidget *itemWidget, const QModelIndex &index);
 
-    virtual bool matches(const QModelIndex &index, const QRegExp &re) const;
+    virtual QString searchableText(const QModelIndex &index) const;
 
 private:
     QVariantMap m_settings;
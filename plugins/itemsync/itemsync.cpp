@@ -641,41 +641,16 @@ ItemSync::ItemSync(const QString &label, const QString &icon, ItemWidget *childI
     m_label->setPlainText(label);
 }
 
-void ItemSync::highlight(const QRegExp &re, const QFont &highlightFont, const QPalette &highlightPalette)
+void ItemSync::setCurrent(bool current)
 {
-    m_childItem->setHighlight(re, highlightFont, highlightPalette);
-
-    QList<QTextEdit::ExtraSelection> selections;
-
-    if ( !re.isEmpty() ) {
-        QTextEdit::ExtraSelection selection;
-        selection.format.setBackground( highlightPalette.base() );
-        selection.format.setForeground( highlightPalette.text() );
-        selection.format.setFont(highlightFont);
-
-        QTextCursor cur = m_label->document()->find(re);
-        int a = cur.position();
-        while ( !cur.isNull() ) {
-            if ( cur.hasSelection() ) {
-                selection.cursor = cur;
-                selections.append(selection);
-            } else {
-                cur.movePosition(QTextCursor::NextCharacter);
-            }
-            cur = m_label->document()->find(re, cur);
-            int b = cur.position();
-            if (a == b) {
-                cur.movePosition(QTextCursor::NextCharacter);
-                cur = m_label->document()->find(re, cur);
-                b = cur.position();
-                if (a == b) break;
-            }
-            a = b;
-        }
-    }
-
-    m_label->setExtraSelections(selections);
+    ItemWidget::setCurrent(current);
+    m_childItem->setCurrent(current);
+}
 
+void ItemSync::highlight(const TextMatcher &matcher, const QFont &highlightFont, const QPalette &highlightPalette)
+{
+    m_childItem->setHighlight(matcher, highlightFont, highlightPalette);
+    highlightMatches(m_label, matcher, highlightFont, highlightPalette);
     update();
 }
 
@@ -1555,11 +1530,10 @@ QVariantMap ItemSyncLoader::copyItem(const QAbstractItemModel &model, const QVar
     return copiedItemData;
 }
 
-bool ItemSyncLoader::matches(const QModelIndex &index, const QRegExp &re) const
+QString ItemSyncLoader::searchableText(const QModelIndex &index) const
 {
     const QVariantMap dataMap = index.data(contentType::data).toMap();
-    const QString text = dataMap.value(mimeBaseName).toString();
-    return re.indexIn(text) != -1;
+    return dataMap.value(mimeBaseName).toString();
 }
 
 QObject *ItemSyncLoader::tests(const TestInterfacePtr &test) const
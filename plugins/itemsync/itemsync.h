@@ -41,8 +41,10 @@ class ItemSync : public QWidget, public ItemWidget
 public:
     ItemSync(const QString &label, const QString &icon, ItemWidget *childItem = NULL);
 
+    virtual void setCurrent(bool current);
+
 protected:
-    virtual void highlight(const QRegExp &re, const QFont &highlightFont,
+    virtual void highlight(const TextMatcher &matcher, const QFont &highlightFont,
                            const QPalette &highlightPalette);
 
     virtual QWidget *createEditor(QWidget *parent) const;
@@ -130,7 +132,7 @@ public:
 
     virtual QVariantMap copyItem(const QAbstractItemModel &model, const QVariantMap &itemData);
 
-    virtual bool matches(const QModelIndex &index, const QRegExp &re) const;
+    virtual QString searchableText(const QModelIndex &index) const;
 
     virtual QObject *tests(const TestInterfacePtr &test) const;
 
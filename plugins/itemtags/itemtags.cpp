@@ -251,9 +251,15 @@ ItemTags::ItemTags(ItemWidget *childItem, const Tags &tags)
     layout->addWidget( m_childItem->widget() );
 }
 
-void ItemTags::highlight(const QRegExp &re, const QFont &highlightFont, const QPalette &highlightPalette)
+void ItemTags::setCurrent(bool current)
 {
-    m_childItem->setHighlight(re, highlightFont, highlightPalette);
+    ItemWidget::setCurrent(current);
+    m_childItem->setCurrent(current);
+}
+
+void ItemTags::highlight(const TextMatcher &matcher, const QFont &highlightFont, const QPalette &highlightPalette)
+{
+    m_childItem->setHighlight(matcher, highlightFont, highlightPalette);
 }
 
 QWidget *ItemTags::createEditor(QWidget *parent) const
@@ -377,9 +383,9 @@ ItemWidget *ItemTagsLoader::transform(ItemWidget *itemWidget, const QModelIndex
     return new ItemTags(itemWidget, tags);
 }
 
-bool ItemTagsLoader::matches(const QModelIndex &index, const QRegExp &re) const
+QString ItemTagsLoader::searchableText(const QModelIndex &index) const
 {
-    return re.indexIn(tags(index)) != -1;
+    return tags(index);
 }
 
 QObject *ItemTagsLoader::tests(const TestInterfacePtr &test) const
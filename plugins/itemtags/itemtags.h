@@ -49,11 +49,13 @@ public:
 
     ItemTags(ItemWidget *childItem, const Tags &tags);
 
+    virtual void setCurrent(bool current);
+
 signals:
     void runCommand(const Command &command);
 
 protected:
-    virtual void highlight(const QRegExp &re, const QFont &highlightFont,
+    virtual void highlight(const TextMatcher &matcher, const QFont &highlightFont,
                            const QPalette &highlightPalette);
 
     virtual QWidget *createEditor(QWidget *parent) const;
@@ -100,7 +102,7 @@ public:
 
     virtual ItemWidget *transform(ItemWidget *itemWidget, const QModelIndex &index);
 
-    virtual bool matches(const QModelIndex &index, const QRegExp &re) const;
+    virtual QString searchableText(const QModelIndex &index) const;
 
     virtual QObject *tests(const TestInterfacePtr &test) const;
 
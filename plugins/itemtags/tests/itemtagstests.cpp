@@ -238,4 +238,7 @@ void ItemSyncTests::searchTags()
     waitFor(waitMsSearch);
     RUN(Args(args) << "keys" << "TAB" << "CTRL+A", "");
     RUN(Args(args) << "testselecteditems", "2\n");
+
+    // Tags are matched separately from item text.
+    RUN(Args(args) << "-e" << "find('^y').rows", "2\n");
 }
@@ -23,14 +23,24 @@
 #include "common/contenttype.h"
 #include "common/mimetypes.h"
 
+#include <QCache>
 #include <QContextMenuEvent>
+#include <QCoreApplication>
+#include <QCryptographicHash>
 #include <QModelIndex>
 #include <QMouseEvent>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPainter>
+#include <QPaintEvent>
 #include <QScrollBar>
+#include <QTextCharFormat>
 #include <QTextBlock>
 #include <QTextCursor>
 #include <QTextDocument>
 #include <QAbstractTextDocumentLayout>
+#include <QRunnable>
+#include <QThreadPool>
 #include <QtPlugin>
 
 namespace {
@@ -38,6 +48,15 @@ namespace {
 // Limit number of characters for performance reasons.
 const int defaultMaxBytes = 100*1024;
 
+// Maximum number of highlighted matches in plain text item.
+const int maxHighlightCount = 1000;
+
+// Longer text is parsed in other thread (only with Qt 5).
+const int maxSynchronousTextLength = 8 * 1024;
+
+// Maximum number of characters in cached documents.
+const int documentCacheCost = 2 * 1024 * 1024;
+
 const char optionUseRichText[] = "use_rich_text";
 const char optionMaximumLines[] = "max_lines";
 const char optionMaximumHeight[] = "max_height";
@@ -75,40 +94,22 @@ bool getText(const QModelIndex &index, QString *text)
     return false;
 }
 
-} // namespace
-
-ItemText::ItemText(const QString &text, bool isRichText, int maxLines, int maximumHeight, QWidget *parent)
-    : QTextBrowser(parent)
-    , ItemWidget(this)
-    , m_textDocument()
-    , m_maximumHeight(maximumHeight)
+QTextDocument *createDocument(const QString &text, bool isRichText, int maxLines, const QFont &font)
 {
-    m_textDocument.setDefaultFont(font());
-
-    setReadOnly(true);
-    setUndoRedoEnabled(false);
-    setOpenExternalLinks(true);
-
-    setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
-    setFrameStyle(QFrame::NoFrame);
-
-    setContextMenuPolicy(Qt::NoContextMenu);
-
-    viewport()->installEventFilter(this);
+    QTextDocument *doc = new QTextDocument();
+    doc->setDefaultFont(font);
 
     if (isRichText)
-        m_textDocument.setHtml( text.left(defaultMaxBytes) );
+        doc->setHtml(text);
     else
-        m_textDocument.setPlainText( text.left(defaultMaxBytes) );
+        doc->setPlainText(text);
 
-    m_textDocument.setDocumentMargin(0);
-
-    setProperty("CopyQ_no_style", isRichText);
+    doc->setDocumentMargin(0);
 
     if (maxLines > 0) {
-        QTextBlock block = m_textDocument.findBlockByLineNumber(maxLines);
+        QTextBlock block = doc->findBlockByLineNumber(maxLines);
         if (block.isValid()) {
-            QTextCursor tc(&m_textDocument);
+            QTextCursor tc(doc);
             tc.setPosition(block.position() - 1);
             tc.movePosition(QTextCursor::End, QTextCursor::KeepAnchor);
             tc.removeSelectedText();
@@ -119,64 +120,237 @@ ItemText::ItemText(const QString &text, bool isRichText, int maxLines, int maxim
         }
     }
 
-    setDocument(&m_textDocument);
+    return doc;
 }
 
-void ItemText::highlight(const QRegExp &re, const QFont &highlightFont, const QPalette &highlightPalette)
+/**
+ * Return true if document should be created in other thread.
+ *
+ * Fonts and text layout are not supported outside GUI thread in Qt 4.
+ */
+bool createDocumentInBackground(const QString &text)
 {
-    QList<QTextBrowser::ExtraSelection> selections;
+#if QT_VERSION < 0x050000
+    Q_UNUSED(text);
+    return false;
+#else
+    return text.size() > maxSynchronousTextLength;
+#endif
+}
 
-    if ( !re.isEmpty() ) {
-        QTextBrowser::ExtraSelection selection;
-        selection.format.setBackground( highlightPalette.base() );
-        selection.format.setForeground( highlightPalette.text() );
-        selection.format.setFont(highlightFont);
+typedef QCache<QString, QTextDocument> DocumentCache;
 
-        QTextCursor cur = m_textDocument.find(re);
-        int a = cur.position();
-        while ( !cur.isNull() ) {
-            if ( cur.hasSelection() ) {
-                selection.cursor = cur;
-                selections.append(selection);
-            } else {
-                cur.movePosition(QTextCursor::NextCharacter);
-            }
-            cur = m_textDocument.find(re, cur);
-            int b = cur.position();
-            if (a == b) {
-                cur.movePosition(QTextCursor::NextCharacter);
-                cur = m_textDocument.find(re, cur);
-                b = cur.position();
-                if (a == b) break;
-            }
-            a = b;
+void clearDocumentCache();
+
+DocumentCache &documentCache()
+{
+    static DocumentCache *cache = NULL;
+    if (cache == NULL) {
+        cache = new DocumentCache(documentCacheCost);
+        // Documents must be destroyed before application.
+        qAddPostRoutine(clearDocumentCache);
+    }
+    return *cache;
+}
+
+void clearDocumentCache()
+{
+    documentCache().clear();
+}
+
+} // namespace
+
+class DocumentRequest
+{
+public:
+    DocumentRequest(const QString &text, bool isRichText, int maxLines, const QFont &font,
+                    QObject *receiver)
+        : m_text(text)
+        , m_isRichText(isRichText)
+        , m_maxLines(maxLines)
+        , m_font(font)
+        , m_mutex()
+        , m_receiver(receiver)
+        , m_document(NULL)
+    {
+    }
+
+    ~DocumentRequest()
+    {
+        // Document lives in receiver's thread if it was not taken.
+        if (m_document != NULL)
+            m_document->deleteLater();
+    }
+
+    void run()
+    {
+        // Skip parsing if widget was destroyed in the meantime (e.g. item scrolled away).
+        if ( isCanceled() )
+            return;
+
+        QScopedPointer<QTextDocument> doc( createDocument(m_text, m_isRichText, m_maxLines, m_font) );
+
+        QMutexLocker lock(&m_mutex);
+        if (m_receiver != NULL) {
+            doc->moveToThread( m_receiver->thread() );
+            m_document = doc.take();
+            QMetaObject::invokeMethod(m_receiver, "onDocumentLoaded", Qt::QueuedConnection);
         }
     }
 
-    setExtraSelections(selections);
+    /** Don't parse text or pass the result to receiver. */
+    void cancel()
+    {
+        QMutexLocker lock(&m_mutex);
+        m_receiver = NULL;
+    }
+
+    /** Return new document (caller takes ownership) or NULL if not available. */
+    QTextDocument *takeDocument()
+    {
+        QMutexLocker lock(&m_mutex);
+        QTextDocument *doc = m_document;
+        m_document = NULL;
+        return doc;
+    }
+
+private:
+    bool isCanceled()
+    {
+        QMutexLocker lock(&m_mutex);
+        return m_receiver == NULL;
+    }
+
+    QString m_text;
+    bool m_isRichText;
+    int m_maxLines;
+    QFont m_font;
+    QMutex m_mutex;
+    QObject *m_receiver;
+    QTextDocument *m_document;
+};
+
+namespace {
+
+class DocumentRunnable : public QRunnable
+{
+public:
+    explicit DocumentRunnable(const QSharedPointer<DocumentRequest> &request)
+        : m_request(request)
+    {
+    }
+
+    void run() { m_request->run(); }
+
+private:
+    QSharedPointer<DocumentRequest> m_request;
+};
+
+} // namespace
+
+ItemText::ItemText(const QString &text, bool isRichText, int maxLines, int maximumHeight, QWidget *parent)
+    : QTextBrowser(parent)
+    , ItemWidget(this)
+    , m_text( text.left(defaultMaxBytes) )
+    , m_textHash( QCryptographicHash::hash(m_text.toUtf8(), QCryptographicHash::Sha1).toHex() )
+    , m_isRichText(isRichText)
+    , m_maxLines(maxLines)
+    , m_maximumHeight(maximumHeight)
+    , m_maximumSize()
+    , m_idealWidth(0)
+    , m_textDocument(NULL)
+    , m_cacheKey()
+    , m_matcher()
+    , m_highlightFont()
+    , m_highlightPalette()
+    , m_request()
+{
+    setReadOnly(true);
+    setUndoRedoEnabled(false);
+    setOpenExternalLinks(true);
 
+    setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    setFrameStyle(QFrame::NoFrame);
+
+    setContextMenuPolicy(Qt::NoContextMenu);
+
+    viewport()->installEventFilter(this);
+
+    setProperty("CopyQ_no_style", isRichText);
+
+    // Document is created (or taken from cache) in updateSize() when font and width are known.
+}
+
+ItemText::~ItemText()
+{
+    if (m_request)
+        m_request->cancel();
+
+    // Keep parsed document in cache so it can be reused if the item is shown again.
+    if (m_textDocument != NULL && !QCoreApplication::closingDown()) {
+        setExtraSelections( QList<QTextEdit::ExtraSelection>() );
+        setDocument(NULL);
+        m_textDocument->setParent(NULL);
+        m_textDocument->documentLayout()->setPaintDevice(NULL);
+        documentCache().insert(m_cacheKey, m_textDocument, m_textDocument->characterCount());
+    }
+}
+
+void ItemText::highlight(const TextMatcher &matcher, const QFont &highlightFont, const QPalette &highlightPalette)
+{
+    m_matcher = matcher;
+    m_highlightFont = highlightFont;
+    m_highlightPalette = highlightPalette;
+
+    highlightMatches(this, matcher, highlightFont, highlightPalette);
     update();
 }
 
 void ItemText::updateSize(const QSize &maximumSize, int idealWidth)
 {
+    m_maximumSize = maximumSize;
+    m_idealWidth = idealWidth;
+
     const int scrollBarWidth = verticalScrollBar()->isVisible() ? verticalScrollBar()->width() : 0;
     setMaximumHeight( maximumSize.height() );
     setFixedWidth(idealWidth);
-    m_textDocument.setTextWidth(idealWidth - scrollBarWidth);
 
-    QTextOption option = m_textDocument.defaultTextOption();
+    if (m_textDocument == NULL) {
+        // Wait for document which is being created in other thread.
+        if (m_request)
+            return;
+
+        m_cacheKey = documentCacheKey();
+        QTextDocument *doc = documentCache().take(m_cacheKey);
+        if ( doc == NULL && !createDocumentInBackground(m_text) )
+            doc = createDocument(m_text, m_isRichText, m_maxLines, font());
+
+        if (doc == NULL) {
+            // Show single line until document is ready.
+            setFixedHeight( fontMetrics().lineSpacing() );
+            m_request = QSharedPointer<DocumentRequest>(
+                        new DocumentRequest(m_text, m_isRichText, m_maxLines, font(), this) );
+            QThreadPool::globalInstance()->start( new DocumentRunnable(m_request) );
+            return;
+        }
+
+        setTextDocument(doc);
+    }
+
+    m_textDocument->setTextWidth(idealWidth - scrollBarWidth);
+
+    QTextOption option = m_textDocument->defaultTextOption();
     const QTextOption::WrapMode wrapMode = maximumSize.width() > idealWidth
             ? QTextOption::NoWrap : QTextOption::WrapAtWordBoundaryOrAnywhere;
     if (wrapMode != option.wrapMode()) {
         option.setWrapMode(wrapMode);
-        m_textDocument.setDefaultTextOption(option);
+        m_textDocument->setDefaultTextOption(option);
     }
 
-    const int h = m_textDocument.size().height();
+    const int h = m_textDocument->size().height();
     setFixedHeight(0 < m_maximumHeight && m_maximumHeight < h ? m_maximumHeight : h);
 
-    const QRectF rect = m_textDocument.documentLayout()->frameBoundingRect(m_textDocument.rootFrame());
+    const QRectF rect = m_textDocument->documentLayout()->frameBoundingRect(m_textDocument->rootFrame());
     setFixedWidth(rect.right());
 }
 
@@ -185,6 +359,216 @@ bool ItemText::eventFilter(QObject *, QEvent *event)
     return ItemWidget::filterMouseEvents(this, event);
 }
 
+void ItemText::onDocumentLoaded()
+{
+    if (!m_request)
+        return;
+
+    QTextDocument *doc = m_request->takeDocument();
+    m_request.clear();
+    if (doc == NULL)
+        return;
+
+    setTextDocument(doc);
+    updateSize(m_maximumSize, m_idealWidth);
+}
+
+void ItemText::setTextDocument(QTextDocument *document)
+{
+    m_textDocument = document;
+    m_textDocument->setParent(this);
+    setDocument(m_textDocument);
+
+    if ( !m_matcher.isEmpty() )
+        highlightMatches(this, m_matcher, m_highlightFont, m_highlightPalette);
+}
+
+QString ItemText::documentCacheKey() const
+{
+    return QString("%1;%2;%3;%4")
+            .arg( QString::fromLatin1(m_textHash) )
+            .arg(m_isRichText)
+            .arg(m_maxLines)
+            .arg( font().toString() );
+}
+
+ItemPlainText::ItemPlainText(const QString &text, int maxLines, int maximumHeight, QWidget *parent)
+    : QWidget(parent)
+    , ItemWidget(this)
+    , m_text( text.left(defaultMaxBytes) )
+    , m_maximumHeight(maximumHeight)
+    , m_wrap(true)
+    , m_layouts()
+    , m_selections()
+    , m_matcher()
+    , m_highlightFont()
+    , m_highlightPalette()
+    , m_textBrowser()
+{
+    if (maxLines > 0) {
+        int i = -1;
+        for ( int line = 0; line < maxLines; ++line ) {
+            i = m_text.indexOf('\n', i + 1);
+            if (i == -1)
+                break;
+        }
+
+        if (i != -1) {
+            m_text.truncate(i);
+            m_text.append( QString(" ") + QChar(0x2026) );
+        }
+    }
+
+    foreach ( const QString &line, m_text.split('\n') )
+        m_layouts.append( new QTextLayout(line) );
+}
+
+ItemPlainText::~ItemPlainText()
+{
+    qDeleteAll(m_layouts);
+}
+
+void ItemPlainText::setCurrent(bool current)
+{
+    ItemWidget::setCurrent(current);
+
+    if (current && m_textBrowser.isNull())
+        createTextBrowser();
+}
+
+void ItemPlainText::highlight(const TextMatcher &matcher, const QFont &highlightFont,
+                              const QPalette &highlightPalette)
+{
+    m_matcher = matcher;
+    m_highlightFont = highlightFont;
+    m_highlightPalette = highlightPalette;
+
+    updateSelections();
+
+    if ( !m_textBrowser.isNull() )
+        highlightMatches(m_textBrowser, matcher, highlightFont, highlightPalette);
+
+    update();
+}
+
+void ItemPlainText::updateSize(const QSize &maximumSize, int idealWidth)
+{
+    m_wrap = maximumSize.width() <= idealWidth;
+
+    QTextOption option;
+    option.setWrapMode(m_wrap ? QTextOption::WrapAtWordBoundaryOrAnywhere : QTextOption::NoWrap);
+
+    qreal y = 0;
+    qreal width = 0;
+    foreach (QTextLayout *layout, m_layouts) {
+        layout->setFont( font() );
+        layout->setTextOption(option);
+        layout->beginLayout();
+        for ( QTextLine line = layout->createLine(); line.isValid(); line = layout->createLine() ) {
+            line.setLineWidth(idealWidth);
+            line.setPosition( QPointF(0, y) );
+            y += line.height();
+            width = qMax( width, line.naturalTextWidth() );
+        }
+        layout->endLayout();
+    }
+
+    const int h = qMin( maximumSize.height(), static_cast<int>(y + 1) );
+    const int w = m_wrap ? idealWidth : qMin( maximumSize.width(), static_cast<int>(width + 1) );
+    setFixedSize( w, 0 < m_maximumHeight && m_maximumHeight < h ? m_maximumHeight : h );
+
+    if ( !m_textBrowser.isNull() ) {
+        m_textBrowser->setLineWrapMode(m_wrap ? QTextEdit::WidgetWidth : QTextEdit::NoWrap);
+        m_textBrowser->setGeometry( rect() );
+    }
+}
+
+bool ItemPlainText::eventFilter(QObject *, QEvent *event)
+{
+    return ItemWidget::filterMouseEvents(m_textBrowser, event);
+}
+
+void ItemPlainText::paintEvent(QPaintEvent *event)
+{
+    // Text browser covers the widget.
+    if ( !m_textBrowser.isNull() )
+        return;
+
+    QPainter painter(this);
+    painter.setPen( palette().color(QPalette::Text) );
+
+    const QRect rect = event->rect();
+    for (int i = 0; i < m_layouts.size(); ++i) {
+        const QTextLayout *layout = m_layouts[i];
+        const QRectF bounds = layout->boundingRect();
+        if ( bounds.bottom() < rect.top() )
+            continue;
+        if ( bounds.top() > rect.bottom() )
+            break;
+
+        layout->draw( &painter, QPointF(0, 0),
+                      i < m_selections.size() ? m_selections[i]
+                                              : QVector<QTextLayout::FormatRange>() );
+    }
+}
+
+void ItemPlainText::createTextBrowser()
+{
+    QTextBrowser *textBrowser = new QTextBrowser(this);
+    textBrowser->setObjectName("item_child");
+    textBrowser->setFont( font() );
+    textBrowser->setReadOnly(true);
+    textBrowser->setUndoRedoEnabled(false);
+    textBrowser->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    textBrowser->setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    textBrowser->setFrameStyle(QFrame::NoFrame);
+    textBrowser->setContextMenuPolicy(Qt::NoContextMenu);
+    textBrowser->setWordWrapMode(QTextOption::WrapAtWordBoundaryOrAnywhere);
+    textBrowser->setLineWrapMode(m_wrap ? QTextEdit::WidgetWidth : QTextEdit::NoWrap);
+    textBrowser->document()->setDocumentMargin(0);
+    textBrowser->setPlainText(m_text);
+    textBrowser->setGeometry( rect() );
+    textBrowser->viewport()->installEventFilter(this);
+    textBrowser->show();
+
+    m_textBrowser = textBrowser;
+
+    if ( !m_matcher.isEmpty() )
+        highlightMatches(m_textBrowser, m_matcher, m_highlightFont, m_highlightPalette);
+}
+
+void ItemPlainText::updateSelections()
+{
+    m_selections.clear();
+
+    if ( m_matcher.isEmpty() )
+        return;
+
+    QTextLayout::FormatRange selection;
+    selection.format.setBackground( m_highlightPalette.base() );
+    selection.format.setForeground( m_highlightPalette.text() );
+    selection.format.setFont(m_highlightFont);
+
+    m_selections.resize( m_layouts.size() );
+
+    int count = 0;
+    for ( int i = 0; i < m_layouts.size() && count < maxHighlightCount; ++i ) {
+        const QString text = m_layouts[i]->text();
+        int length;
+        for ( int pos = m_matcher.indexIn(text, 0, &length);
+              pos != -1 && count < maxHighlightCount;
+              pos = m_matcher.indexIn(text, pos + qMax(1, length), &length) )
+        {
+            if (length > 0) {
+                selection.start = pos;
+                selection.length = length;
+                m_selections[i].append(selection);
+                ++count;
+            }
+        }
+    }
+}
+
 ItemTextLoader::ItemTextLoader()
 {
 }
@@ -204,6 +588,11 @@ ItemWidget *ItemTextLoader::create(const QModelIndex &index, QWidget *parent) co
 
     const int maxLines = m_settings.value(optionMaximumLines, 0).toInt();
     const int maxHeight = m_settings.value(optionMaximumHeight, 0).toInt();
+
+    // Plain text is rendered without creating text document and editor widget.
+    if (!isRichText)
+        return new ItemPlainText(text, maxLines, maxHeight, parent);
+
     return new ItemText(text, isRichText, maxLines, maxHeight, parent);
 }
 
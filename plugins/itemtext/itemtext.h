@@ -21,16 +21,31 @@
 #define ITEMTEXT_H
 
 #include "gui/icons.h"
+#include "common/textmatcher.h"
 #include "item/itemwidget.h"
 
+#include <QList>
+#include <QPointer>
 #include <QScopedPointer>
+#include <QSharedPointer>
 #include <QTextDocument>
 #include <QTextBrowser>
+#include <QTextLayout>
+#include <QVector>
 
 namespace Ui {
 class ItemTextSettings;
 }
 
+class DocumentRequest;
+
+/**
+ * Widget for rich text items.
+ *
+ * Long HTML is parsed in other thread. Parsed documents are cached (for given text
+ * and font) after the widget is destroyed so they can be reused when the item is
+ * shown again.
+ */
 class ItemText : public QTextBrowser, public ItemWidget
 {
     Q_OBJECT
@@ -38,17 +53,84 @@ class ItemText : public QTextBrowser, public ItemWidget
 public:
     ItemText(const QString &text, bool isRichText, int maxLines, int maximumHeight, QWidget *parent);
 
+    ~ItemText();
+
+protected:
+    virtual void highlight(const TextMatcher &matcher, const QFont &highlightFont,
+                           const QPalette &highlightPalette);
+
+    virtual void updateSize(const QSize &maximumSize, int idealWidth);
+
+    virtual bool eventFilter(QObject *, QEvent *event);
+
+private slots:
+    void onDocumentLoaded();
+
+private:
+    void setTextDocument(QTextDocument *document);
+
+    /** Return key for document cache. */
+    QString documentCacheKey() const;
+
+    QString m_text;
+    QByteArray m_textHash;
+    bool m_isRichText;
+    int m_maxLines;
+    int m_maximumHeight;
+    QSize m_maximumSize;
+    int m_idealWidth;
+    QTextDocument *m_textDocument;
+    QString m_cacheKey; ///< Cache key for current document.
+    TextMatcher m_matcher;
+    QFont m_highlightFont;
+    QPalette m_highlightPalette;
+    QSharedPointer<DocumentRequest> m_request;
+};
+
+/**
+ * Lightweight widget for plain text items.
+ *
+ * Text is laid out and painted using QTextLayout directly (no QTextDocument and editor
+ * widget are created). Text browser widget allowing to select text is created only after
+ * the item becomes current.
+ */
+class ItemPlainText : public QWidget, public ItemWidget
+{
+    Q_OBJECT
+
+public:
+    ItemPlainText(const QString &text, int maxLines, int maximumHeight, QWidget *parent);
+
+    ~ItemPlainText();
+
+    virtual void setCurrent(bool current);
+
 protected:
-    virtual void highlight(const QRegExp &re, const QFont &highlightFont,
+    virtual void highlight(const TextMatcher &matcher, const QFont &highlightFont,
                            const QPalette &highlightPalette);
 
     virtual void updateSize(const QSize &maximumSize, int idealWidth);
 
     virtual bool eventFilter(QObject *, QEvent *event);
 
+    void paintEvent(QPaintEvent *event);
+
 private:
-    QTextDocument m_textDocument;
+    /** Create text browser widget (covering this widget) for selecting text. */
+    void createTextBrowser();
+
+    /** Find matches in each line (number of matches is limited). */
+    void updateSelections();
+
+    QString m_text;
     int m_maximumHeight;
+    bool m_wrap;
+    QList<QTextLayout*> m_layouts; ///< Layout for each line of text.
+    QVector< QVector<QTextLayout::FormatRange> > m_selections; ///< Highlighted matches.
+    TextMatcher m_matcher;
+    QFont m_highlightFont;
+    QPalette m_highlightPalette;
+    QPointer<QTextBrowser> m_textBrowser;
 };
 
 class ItemTextLoader : public QObject, public ItemLoaderInterface
@@ -23,11 +23,18 @@
 #include "common/contenttype.h"
 
 #include <QApplication>
+#include <QCache>
+#include <QCryptographicHash>
 #include <QDesktopWidget>
 #include <QDesktopServices>
+#include <QList>
 #include <QModelIndex>
 #include <QMouseEvent>
+#include <QPainter>
+#include <QPaintEvent>
 #include <QPalette>
+#include <QTextDocumentFragment>
+#include <QTimer>
 #include <QtPlugin>
 #include <QtWebKit/QWebHistory>
 #if QT_VERSION < 0x050000
@@ -43,6 +50,25 @@ namespace {
 
 const char optionMaximumHeight[] = "max_height";
 
+// Set some remote URL as base URL so we can include remote scripts in web view for current item.
+// Snapshots are rendered without base URL so relative links are not fetched for all items.
+const char baseUrl[] = "http://example.com/";
+
+// Maximum height of snapshot (snapshots shouldn't take most of the cache).
+const int maxSnapshotHeight = 2048;
+
+// Stop loading page for snapshot after given time (in ms) so other pages are not blocked.
+const int renderTimeoutMs = 5000;
+
+// Number of unused web views kept for reuse.
+const int maxPooledWebViews = 2;
+
+// Maximum size of cached snapshots in KiB.
+const int snapshotCacheSize = 32 * 1024;
+
+// Maximum number of different matched texts highlighted in page.
+const int maxHighlightedTexts = 16;
+
 bool getHtml(const QModelIndex &index, QString *text)
 {
     *text = index.data(contentType::html).toString();
@@ -61,146 +87,511 @@ bool canMouseInteract(const QInputEvent &event)
     return event.modifiers() & Qt::ShiftModifier;
 }
 
-} // namespace
-
-ItemWeb::ItemWeb(const QString &html, int maximumHeight, QWidget *parent)
-    : QWebView(parent)
-    , ItemWidget(this)
-    , m_copyOnMouseUp(false)
-    , m_maximumHeight(maximumHeight)
+void setDefaultFont(QWebSettings *settings, const QFont &font)
 {
-    QWebFrame *frame = page()->mainFrame();
-    frame->setScrollBarPolicy(Qt::Horizontal, Qt::ScrollBarAlwaysOff);
-
-    const QFont &defaultFont = font();
-    settings()->setFontFamily(QWebSettings::StandardFont, defaultFont.family());
+    settings->setFontFamily(QWebSettings::StandardFont, font.family());
     // DPI resolution can be different than the one used by this widget.
     QWidget* window = QApplication::desktop()->screen();
     int dpi = window->logicalDpiX();
-    int pt = defaultFont.pointSize();
-    settings()->setFontSize(QWebSettings::DefaultFontSize, pt * dpi / 72);
+    int pt = font.pointSize();
+    settings->setFontSize(QWebSettings::DefaultFontSize, pt * dpi / 72);
+}
 
-    history()->setMaximumItemCount(0);
+/** Return different texts matching @a matcher in @a text. */
+QStringList matchedTexts(const TextMatcher &matcher, const QString &text)
+{
+    QStringList texts;
+    if ( matcher.isEmpty() )
+        return texts;
+
+    int length;
+    for ( int i = matcher.indexIn(text, 0, &length);
+          i != -1 && texts.size() < maxHighlightedTexts;
+          i = matcher.indexIn(text, i + qMax(1, length), &length) )
+    {
+        const QString match = text.mid(i, length);
+        if ( !match.isEmpty() && !texts.contains(match) )
+            texts.append(match);
+    }
 
-    QPalette pal(palette());
+    return texts;
+}
+
+void highlightTexts(QWebPage *page, const QStringList &texts)
+{
+    // FIXME: Set hightlight color and font!
+    page->findText( QString(), QWebPage::HighlightAllOccurrences );
+    foreach (const QString &text, texts)
+        page->findText( text, QWebPage::HighlightAllOccurrences );
+}
+
+void setTransparentBackground(QWebPage *page)
+{
+    QPalette pal( page->palette() );
     pal.setBrush(QPalette::Base, Qt::transparent);
-    page()->setPalette(pal);
-    setAttribute(Qt::WA_OpaquePaintEvent, false);
+    page->setPalette(pal);
+}
+
+/**
+ * Web view for current item (allows to select text and open links).
+ */
+class ItemWebView : public QWebView
+{
+    Q_OBJECT
+
+public:
+    ItemWebView()
+        : QWebView()
+        , m_copyOnMouseUp(false)
+    {
+        QWebFrame *frame = page()->mainFrame();
+        frame->setScrollBarPolicy(Qt::Horizontal, Qt::ScrollBarAlwaysOff);
+
+        history()->setMaximumItemCount(0);
+
+        setTransparentBackground( page() );
+        setAttribute(Qt::WA_OpaquePaintEvent, false);
+
+        setContextMenuPolicy(Qt::NoContextMenu);
+
+        // Selecting text copies it to clipboard.
+        connect( this, SIGNAL(selectionChanged()), SLOT(onSelectionChanged()) );
+
+        // Open link with external application.
+        page()->setLinkDelegationPolicy(QWebPage::DelegateAllLinks);
+        connect( page(), SIGNAL(linkClicked(QUrl)), SLOT(onLinkClicked(QUrl)) );
+    }
+
+protected:
+    void mousePressEvent(QMouseEvent *e)
+    {
+        if ( canMouseInteract(*e) ) {
+            QMouseEvent e2(QEvent::MouseButtonPress, e->pos(), Qt::LeftButton, Qt::LeftButton, Qt::NoModifier );
+            QCoreApplication::sendEvent( page(), &e2 );
+            QWebView::mousePressEvent(e);
+            e->ignore();
+        } else {
+            e->ignore();
+            QWebView::mousePressEvent(e);
+        }
+    }
+
+    void mouseMoveEvent(QMouseEvent *e)
+    {
+        if ( canMouseInteract(*e) )
+            QWebView::mousePressEvent(e);
+        else
+            e->ignore();
+    }
+
+    void wheelEvent(QWheelEvent *e)
+    {
+        if ( canMouseInteract(*e) )
+            QWebView::wheelEvent(e);
+        else
+            e->ignore();
+    }
+
+    void mouseReleaseEvent(QMouseEvent *e)
+    {
+        if (m_copyOnMouseUp) {
+            m_copyOnMouseUp = false;
+#if QT_VERSION >= 0x040800
+            if ( hasSelection() )
+#endif
+                triggerPageAction(QWebPage::Copy);
+        } else {
+            QWebView::mouseReleaseEvent(e);
+        }
+    }
+
+    void mouseDoubleClickEvent(QMouseEvent *e)
+    {
+        if ( canMouseInteract(*e) )
+            QWebView::mouseDoubleClickEvent(e);
+        else
+            e->ignore();
+    }
+
+private slots:
+    void onSelectionChanged()
+    {
+        m_copyOnMouseUp = true;
+    }
+
+    void onLinkClicked(const QUrl &url)
+    {
+        if ( !QDesktopServices::openUrl(url) )
+            load(url);
+    }
+
+private:
+    bool m_copyOnMouseUp;
+};
+
+/**
+ * Renders pages to snapshots one by one using single off-screen web page
+ * and keeps few unused web views for reuse.
+ */
+class WebRenderer : public QObject
+{
+    Q_OBJECT
+
+public:
+    static WebRenderer *instance()
+    {
+        // Web page and views are destroyed in clear() before application exits.
+        static WebRenderer *renderer = new WebRenderer();
+        return renderer;
+    }
+
+    /** Return cached snapshot or NULL. */
+    const QPixmap *snapshot(const QString &key) const
+    {
+        return m_snapshots.object(key);
+    }
+
+    /** Render @a html and pass the result to ItemWeb::setSnapshot() of @a item. */
+    void render(ItemWeb *item, const QString &key, const QString &html, const QFont &font,
+                int width, int maximumHeight, const QStringList &highlightTexts)
+    {
+        if (m_closing)
+            return;
+
+        // Drop older waiting requests for the item (page being loaded is always first).
+        for ( int i = m_jobs.size() - 1; i >= (m_busy ? 1 : 0); --i ) {
+            if (m_jobs[i].item == item)
+                m_jobs.removeAt(i);
+        }
+
+        Job job;
+        job.item = item;
+        job.key = key;
+        job.html = html;
+        job.font = font;
+        job.width = width;
+        job.maximumHeight = maximumHeight;
+        job.highlightTexts = highlightTexts;
+        m_jobs.append(job);
+
+        if (!m_busy)
+            renderNext();
+    }
+
+    QWebView *takeView(QWidget *parent)
+    {
+        QWebView *view = m_views.isEmpty() ? new ItemWebView() : m_views.takeLast();
+        view->setParent(parent);
+        return view;
+    }
 
-    setContextMenuPolicy(Qt::NoContextMenu);
+    void releaseView(QWebView *view)
+    {
+        view->hide();
+        view->setParent(NULL);
+
+        if ( m_closing || m_views.size() >= maxPooledWebViews ) {
+            delete view;
+        } else {
+            view->setHtml(QString());
+            m_views.append(view);
+        }
+    }
+
+private slots:
+    void renderNext()
+    {
+        // Skip jobs for destroyed items and pages rendered in the meantime.
+        while ( !m_jobs.isEmpty() ) {
+            const Job &job = m_jobs.first();
+            const QPixmap *cached = snapshot(job.key);
+            if ( !job.item.isNull() && cached == NULL )
+                break;
+            if ( !job.item.isNull() )
+                job.item->setSnapshot(job.key, *cached);
+            m_jobs.removeFirst();
+        }
+
+        if ( m_jobs.isEmpty() || m_closing )
+            return;
+
+        if (m_page == NULL)
+            createPage();
+
+        const Job &job = m_jobs.first();
+        setDefaultFont( m_page->settings(), job.font );
+        m_page->setPreferredContentsSize( QSize(job.width, 10) );
+        m_page->setViewportSize( QSize(job.width, 10) );
+
+        m_busy = true;
+        m_timerRender.start();
+        m_page->mainFrame()->setHtml( job.html, QUrl() );
+    }
+
+    void onRenderTimeout()
+    {
+        if (!m_busy)
+            return;
+
+        // Render what is loaded so far.
+        m_page->triggerAction(QWebPage::Stop);
+        onLoadFinished();
+    }
+
+    void onLoadFinished()
+    {
+        if (!m_busy || m_jobs.isEmpty())
+            return;
+
+        m_busy = false;
+        m_timerRender.stop();
+        const Job job = m_jobs.takeFirst();
 
-    // Selecting text copies it to clipboard.
-    connect( this, SIGNAL(selectionChanged()), SLOT(onSelectionChanged()) );
+        QWebFrame *frame = m_page->mainFrame();
+        int h = frame->contentsSize().height();
+        if (0 < job.maximumHeight && job.maximumHeight < h)
+            h = job.maximumHeight;
+        const QSize size( job.width, qMax(1, h) );
+        m_page->setViewportSize(size);
 
-    // Open link with external application.
-    page()->setLinkDelegationPolicy(QWebPage::DelegateAllLinks);
-    connect( page(), SIGNAL(linkClicked(QUrl)), SLOT(onLinkClicked(QUrl)) );
+        if ( !job.highlightTexts.isEmpty() )
+            highlightTexts(m_page, job.highlightTexts);
+
+        QPixmap pixmap(size);
+        pixmap.fill(Qt::transparent);
+        QPainter painter(&pixmap);
+        frame->render(&painter);
+        painter.end();
+
+        const int cost = size.width() * size.height() * pixmap.depth() / 8 / 1024;
+        m_snapshots.insert( job.key, new QPixmap(pixmap), qMax(1, cost) );
+
+        if ( !job.item.isNull() )
+            job.item->setSnapshot(job.key, pixmap);
+
+        // Don't load next page from signal handler.
+        QMetaObject::invokeMethod(this, "renderNext", Qt::QueuedConnection);
+    }
+
+    void clear()
+    {
+        m_closing = true;
+        m_timerRender.stop();
+        m_jobs.clear();
+        m_snapshots.clear();
+        qDeleteAll(m_views);
+        m_views.clear();
+        delete m_page;
+        m_page = NULL;
+    }
 
+private:
+    struct Job {
+        QPointer<ItemWeb> item;
+        QString key;
+        QString html;
+        QFont font;
+        int width;
+        int maximumHeight;
+        QStringList highlightTexts;
+    };
+
+    WebRenderer()
+        : m_page(NULL)
+        , m_jobs()
+        , m_busy(false)
+        , m_closing(false)
+        , m_snapshots(snapshotCacheSize)
+        , m_views()
+        , m_timerRender()
+    {
+        m_timerRender.setSingleShot(true);
+        m_timerRender.setInterval(renderTimeoutMs);
+        connect( &m_timerRender, SIGNAL(timeout()), SLOT(onRenderTimeout()) );
+
+        connect( qApp, SIGNAL(aboutToQuit()), SLOT(clear()) );
+    }
+
+    void createPage()
+    {
+        m_page = new QWebPage(this);
+        QWebFrame *frame = m_page->mainFrame();
+        frame->setScrollBarPolicy(Qt::Horizontal, Qt::ScrollBarAlwaysOff);
+        frame->setScrollBarPolicy(Qt::Vertical, Qt::ScrollBarAlwaysOff);
+        m_page->history()->setMaximumItemCount(0);
+        setTransparentBackground(m_page);
+        m_page->setLinkDelegationPolicy(QWebPage::DelegateAllLinks);
+        connect( m_page, SIGNAL(loadFinished(bool)), SLOT(onLoadFinished()) );
+    }
+
+    QWebPage *m_page;
+    QList<Job> m_jobs;
+    bool m_busy;
+    bool m_closing;
+    QCache<QString, QPixmap> m_snapshots;
+    QList<QWebView*> m_views;
+    QTimer m_timerRender;
+};
+
+} // namespace
+
+ItemWeb::ItemWeb(const QString &html, const QString &text, int maximumHeight, QWidget *parent)
+    : QWidget(parent)
+    , ItemWidget(this)
+    , m_html(html)
+    , m_htmlHash( QCryptographicHash::hash(html.toUtf8(), QCryptographicHash::Sha1).toHex() )
+    , m_text(text)
+    , m_maximumHeight(maximumHeight)
+    , m_maximumSize()
+    , m_highlightTexts()
+    , m_snapshotKey()
+    , m_snapshot()
+    , m_webView()
+{
     setProperty("CopyQ_no_style", true);
+}
 
-    // Set some remote URL as base URL so we can include remote scripts.
-    setHtml(html, QUrl("http://example.com/"));
+ItemWeb::~ItemWeb()
+{
+    releaseWebView();
 }
 
-void ItemWeb::highlight(const QRegExp &re, const QFont &, const QPalette &)
+void ItemWeb::setCurrent(bool current)
 {
-    // FIXME: Set hightlight color and font!
-    // FIXME: Hightlight text matching regular expression!
-    findText( QString(), QWebPage::HighlightAllOccurrences );
+    ItemWidget::setCurrent(current);
 
-    if ( !re.isEmpty() )
-        findText( re.pattern(), QWebPage::HighlightAllOccurrences );
+    if (current)
+        createWebView();
+    else
+        releaseWebView();
 }
 
-void ItemWeb::onItemChanged()
+void ItemWeb::setSnapshot(const QString &key, const QPixmap &snapshot)
 {
-    updateSize(m_maximumSize, 0);
+    // Ignore outdated snapshots.
+    if (key != m_snapshotKey)
+        return;
+
+    m_snapshot = snapshot;
+    setFixedSize( snapshot.size() );
+    if ( !m_webView.isNull() )
+        m_webView->setGeometry( rect() );
+    update();
 }
 
-void ItemWeb::updateSize(const QSize &maximumSize, int)
+void ItemWeb::highlight(const TextMatcher &matcher, const QFont &, const QPalette &)
 {
-    QWebFrame *frame = page()->mainFrame();
-    disconnect( frame, SIGNAL(contentsSizeChanged(QSize)),
-                this, SLOT(onItemChanged()) );
+    // Only pages with matches are rendered again (with different snapshot key).
+    m_highlightTexts = matcher.isEmpty() ? QStringList() : matchedTexts(matcher, plainText());
 
-    setMaximumSize(maximumSize);
-    m_maximumSize = maximumSize;
+    if ( !m_webView.isNull() )
+        highlightTexts( m_webView->page(), m_highlightTexts );
 
-    const int w = maximumSize.width();
-    const int scrollBarWidth = frame->scrollBarGeometry(Qt::Vertical).width();
-    page()->setPreferredContentsSize( QSize(w - scrollBarWidth, 10) );
+    updateSnapshot();
+}
 
-    int h = frame->contentsSize().height();
-    if (0 < m_maximumHeight && m_maximumHeight < h)
-        h = m_maximumHeight;
+void ItemWeb::updateSize(const QSize &maximumSize, int)
+{
+    setMaximumSize(maximumSize);
+    m_maximumSize = maximumSize;
+    updateSnapshot();
+}
 
-    const QSize size(w, h);
-    page()->setViewportSize(size);
-    setFixedSize(size);
+void ItemWeb::paintEvent(QPaintEvent *event)
+{
+    // Live web view covers the widget.
+    if ( !m_webView.isNull() && m_webView->isVisible() )
+        return;
 
-    connect( frame, SIGNAL(contentsSizeChanged(QSize)),
-             this, SLOT(onItemChanged()) );
+    QPainter painter(this);
+    painter.drawPixmap( event->rect(), m_snapshot, event->rect() );
 }
 
-void ItemWeb::onSelectionChanged()
+void ItemWeb::onWebViewLoaded()
 {
-    m_copyOnMouseUp = true;
+    if ( m_webView.isNull() )
+        return;
+
+    m_webView->setGeometry( rect() );
+    m_webView->show();
+    highlightTexts( m_webView->page(), m_highlightTexts );
 }
 
-void ItemWeb::onLinkClicked(const QUrl &url)
+QString ItemWeb::snapshotKey() const
 {
-    if ( !QDesktopServices::openUrl(url) )
-        load(url);
+    const QString key = QString("%1;%2;%3;%4")
+            .arg( QString::fromLatin1(m_htmlHash) )
+            .arg( m_maximumSize.width() )
+            .arg( maximumSnapshotHeight() )
+            .arg( font().toString() );
+
+    return m_highlightTexts.isEmpty() ? key : key + ";" + m_highlightTexts.join("\n");
 }
 
-void ItemWeb::mousePressEvent(QMouseEvent *e)
+int ItemWeb::maximumSnapshotHeight() const
 {
-    if ( canMouseInteract(*e) ) {
-        QMouseEvent e2(QEvent::MouseButtonPress, e->pos(), Qt::LeftButton, Qt::LeftButton, Qt::NoModifier );
-        QCoreApplication::sendEvent( page(), &e2 );
-        QWebView::mousePressEvent(e);
-        e->ignore();
-    } else {
-        e->ignore();
-        QWebView::mousePressEvent(e);
-    }
+    const int h = 0 < m_maximumHeight && m_maximumHeight < m_maximumSize.height()
+            ? m_maximumHeight : m_maximumSize.height();
+    return qMin(h, maxSnapshotHeight);
 }
 
-void ItemWeb::mouseMoveEvent(QMouseEvent *e)
+const QString &ItemWeb::plainText()
 {
-    if ( canMouseInteract(*e) )
-        QWebView::mousePressEvent(e);
-    else
-        e->ignore();
+    if ( m_text.isEmpty() )
+        m_text = QTextDocumentFragment::fromHtml(m_html).toPlainText();
+    return m_text;
 }
 
-void ItemWeb::wheelEvent(QWheelEvent *e)
+void ItemWeb::updateSnapshot()
 {
-    if ( canMouseInteract(*e) )
-        QWebView::wheelEvent(e);
-    else
-        e->ignore();
+    if ( !m_maximumSize.isValid() )
+        return;
+
+    const QString key = snapshotKey();
+    if (key == m_snapshotKey)
+        return;
+
+    m_snapshotKey = key;
+
+    WebRenderer *renderer = WebRenderer::instance();
+    const QPixmap *cached = renderer->snapshot(key);
+    if (cached != NULL) {
+        setSnapshot(key, *cached);
+        return;
+    }
+
+    // Show single line until page is rendered.
+    if ( m_snapshot.isNull() )
+        setFixedSize( m_maximumSize.width(), fontMetrics().lineSpacing() );
+
+    renderer->render( this, key, m_html, font(), m_maximumSize.width(), maximumSnapshotHeight(),
+                      m_highlightTexts );
 }
 
-void ItemWeb::mouseReleaseEvent(QMouseEvent *e)
+void ItemWeb::createWebView()
 {
-    if (m_copyOnMouseUp) {
-        m_copyOnMouseUp = false;
-#if QT_VERSION >= 0x040800
-        if ( hasSelection() )
-#endif
-            triggerPageAction(QWebPage::Copy);
-    } else {
-        QWebView::mouseReleaseEvent(e);
-    }
+    if ( !m_webView.isNull() )
+        return;
+
+    // Web view is shown after the page is loaded; snapshot is shown until then.
+    m_webView = WebRenderer::instance()->takeView(this);
+    m_webView->hide();
+    setDefaultFont( m_webView->settings(), font() );
+    m_webView->page()->setPreferredContentsSize( QSize(m_maximumSize.width(), 10) );
+    m_webView->setGeometry( rect() );
+    connect( m_webView, SIGNAL(loadFinished(bool)), SLOT(onWebViewLoaded()) );
+    m_webView->setHtml( m_html, QUrl(baseUrl) );
 }
 
-void ItemWeb::mouseDoubleClickEvent(QMouseEvent *e)
+void ItemWeb::releaseWebView()
 {
-    if ( canMouseInteract(*e) )
-        QWebView::mouseDoubleClickEvent(e);
-    else
-        e->ignore();
+    if ( m_webView.isNull() )
+        return;
+
+    m_webView->disconnect(this);
+    WebRenderer::instance()->releaseView(m_webView);
+    m_webView = NULL;
+    update();
 }
 
 ItemWebLoader::ItemWebLoader()
@@ -214,8 +605,10 @@ ItemWebLoader::~ItemWebLoader()
 ItemWidget *ItemWebLoader::create(const QModelIndex &index, QWidget *parent) const
 {
     QString html;
-    if ( getHtml(index, &html) )
-        return new ItemWeb(html, m_settings.value(optionMaximumHeight, 0).toInt(), parent);
+    if ( getHtml(index, &html) ) {
+        const QString text = index.data(contentType::text).toString();
+        return new ItemWeb(html, text, m_settings.value(optionMaximumHeight, 0).toInt(), parent);
+    }
 
     return NULL;
 }
@@ -241,3 +634,5 @@ QWidget *ItemWebLoader::createSettingsWidget(QWidget *parent)
 }
 
 Q_EXPORT_PLUGIN2(itemweb, ItemWebLoader)
+
+#include "itemweb.moc"
@@ -21,10 +21,15 @@
 #define ITEMWEB_H
 
 #include "gui/icons.h"
+#include "common/textmatcher.h"
 #include "item/itemwidget.h"
 
+#include <QPixmap>
+#include <QPointer>
 #include <QScopedPointer>
+#include <QStringList>
 #include <QVariantMap>
+#include <QWidget>
 
 #if QT_VERSION < 0x050000
 #   include <QtWebKit/QWebView>
@@ -36,40 +41,66 @@ namespace Ui {
 class ItemWebSettings;
 }
 
-class ItemWeb : public QWebView, public ItemWidget
+/**
+ * Web page item.
+ *
+ * Page is rendered into a (cached) snapshot pixmap using shared off-screen web page.
+ * Live web view (allowing to select text and open links) is created only for
+ * current item.
+ *
+ * Pages matching search are rendered again with highlighted matches
+ * (snapshots for other pages are reused).
+ */
+class ItemWeb : public QWidget, public ItemWidget
 {
     Q_OBJECT
 
 public:
-    ItemWeb(const QString &html, int maximumHeight, QWidget *parent);
+    ItemWeb(const QString &html, const QString &text, int maximumHeight, QWidget *parent);
+
+    ~ItemWeb();
+
+    virtual void setCurrent(bool current);
+
+    /** Show rendered page (called by renderer). */
+    void setSnapshot(const QString &key, const QPixmap &snapshot);
 
 protected:
-    void highlight(const QRegExp &re, const QFont &highlightFont,
+    void highlight(const TextMatcher &matcher, const QFont &highlightFont,
                    const QPalette &highlightPalette);
 
     virtual void updateSize(const QSize &maximumSize, int idealWidth);
 
-    virtual void mousePressEvent(QMouseEvent *e);
+    void paintEvent(QPaintEvent *event);
 
-    virtual void mouseMoveEvent(QMouseEvent *e);
+private slots:
+    void onWebViewLoaded();
 
-    virtual void wheelEvent(QWheelEvent *e);
+private:
+    /** Return key for snapshot cache. */
+    QString snapshotKey() const;
 
-    virtual void mouseReleaseEvent(QMouseEvent *e);
+    int maximumSnapshotHeight() const;
 
-    virtual void mouseDoubleClickEvent(QMouseEvent *e);
+    /** Return plain text of the page (used to find matches to highlight). */
+    const QString &plainText();
 
-private slots:
-    void onSelectionChanged();
-    void onLinkClicked(const QUrl &url);
+    /** Use cached snapshot or request rendering the page. */
+    void updateSnapshot();
 
-private slots:
-    void onItemChanged();
+    void createWebView();
 
-private:
-    bool m_copyOnMouseUp;
+    void releaseWebView();
+
+    QString m_html;
+    QByteArray m_htmlHash;
+    QString m_text;
     int m_maximumHeight;
     QSize m_maximumSize;
+    QStringList m_highlightTexts;
+    QString m_snapshotKey;
+    QPixmap m_snapshot;
+    QPointer<QWebView> m_webView;
 };
 
 class ItemWebLoader : public QObject, public ItemLoaderInterface
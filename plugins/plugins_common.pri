@@ -3,8 +3,10 @@ include("../common.pri")
 TEMPLATE     = lib
 CONFIG      += plugin
 INCLUDEPATH += ../../src
-HEADERS     += ../../src/item/itemwidget.h
-SOURCES     += ../../src/item/itemwidget.cpp
+HEADERS     += ../../src/item/itemwidget.h \
+               ../../src/common/textmatcher.h
+SOURCES     += ../../src/item/itemwidget.cpp \
+               ../../src/common/textmatcher.cpp
 DESTDIR      = ../
 
 QT += core gui
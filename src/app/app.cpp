@@ -19,6 +19,7 @@
 
 #include "app.h"
 
+#include "common/client_server.h"
 #include "common/log.h"
 #include "common/settings.h"
 #include "platform/platformnativeinterface.h"
@@ -55,8 +56,9 @@ bool isTesting()
 }
 
 /**
- * Change application name for tests and set "CopyQ_test_id" property of application
- * to current test ID. The ID is "CORE" for core tests and ItemLoaderInterface::id() for plugins.
+ * Set "CopyQ_test_id" property of application to current test ID (application name
+ * for tests is changed in initSession()). The ID is "CORE" for core tests and
+ * ItemLoaderInterface::id() for plugins.
  *
  * This function does nothing if isTesting() returns false.
  */
@@ -65,10 +67,6 @@ void initTests()
     if ( !isTesting() )
         return;
 
-    const QString session = QCoreApplication::organizationName() + ".test";
-    QCoreApplication::setOrganizationName(session);
-    QCoreApplication::setApplicationName(session);
-
     const QString testId = QString::fromUtf8( qgetenv("COPYQ_TEST_ID") );
     qApp->setProperty("CopyQ_test_id", testId);
 }
@@ -184,19 +182,12 @@ App::App(QCoreApplication *application,
     , m_exitCode(0)
     , m_closed(false)
 {
-    QString session("copyq");
-    if ( !sessionName.isEmpty() ) {
-        session += "-" + sessionName;
+    if ( !sessionName.isEmpty() )
         m_app->setProperty( "CopyQ_session_name", QVariant(sessionName) );
-    }
 
     m_app->setProperty("CopyQ_server", isMainApp);
 
-    qputenv("COPYQ_SESSION_NAME", sessionName.toUtf8());
-    qputenv("COPYQ", QCoreApplication::applicationFilePath().toUtf8());
-
-    QCoreApplication::setOrganizationName(session);
-    QCoreApplication::setApplicationName(session);
+    initSession(sessionName);
 
 #ifdef HAS_TESTS
     initTests();
@@ -21,9 +21,12 @@
 
 #include "common/arguments.h"
 #include "common/clientsocket.h"
+#include "common/commandstatus.h"
+#include "common/log.h"
 
 #include <QCoreApplication>
 #include <QDataStream>
+#include <QFile>
 #include <QLocalSocket>
 #include <QThread>
 
@@ -37,6 +40,31 @@ void Client::sendMessage(const QByteArray &message, int messageCode)
     emit sendMessageRequest(message, messageCode);
 }
 
+bool Client::handleCommandMessage(const QByteArray &message, int messageCode)
+{
+    if (messageCode == CommandActivateWindow) {
+        COPYQ_LOG("Activating window.");
+        activateWindow(message);
+    } else if (messageCode == CommandReadInput) {
+        COPYQ_LOG("Sending standard input.");
+        QFile in;
+        in.open(stdin, QIODevice::ReadOnly);
+        sendMessage( in.readAll(), 0 );
+    } else {
+        QFile f;
+        f.open((messageCode == CommandSuccess || messageCode == CommandFinished) ? stdout : stderr, QIODevice::WriteOnly);
+        f.write(message);
+    }
+
+    COPYQ_LOG( QString("Message received with exit code %1.").arg(messageCode) );
+
+    return messageCode == CommandFinished || messageCode == CommandBadSyntax || messageCode == CommandError;
+}
+
+void Client::activateWindow(const QByteArray &)
+{
+}
+
 bool Client::startClientSocket(const QString &serverName, const Arguments &arguments)
 {
     QLocalSocket *localSocket = new QLocalSocket(this);
@@ -52,8 +80,10 @@ bool Client::startClientSocket(const QString &serverName, const Arguments &argum
     socket->moveToThread(t);
     t->start();
 
+    // Stop reading from socket until the message is handled
+    // so server doesn't send more data than client can process.
     connect( socket, SIGNAL(messageReceived(QByteArray,int)),
-             this, SLOT(onMessageReceived(QByteArray,int)) );
+             this, SLOT(onMessageReceived(QByteArray,int)), Qt::BlockingQueuedConnection );
     connect( socket, SIGNAL(disconnected()),
              this, SLOT(onDisconnected()) );
     connect( qApp, SIGNAL(aboutToQuit()),
@@ -37,6 +37,17 @@ protected:
 
     void sendMessage(const QByteArray &message, int messageCode);
 
+    /**
+     * Handle message for command sent by server (print output, send standard input
+     * or activate window).
+     *
+     * Returns true if command finished and client should exit with @a messageCode.
+     */
+    bool handleCommandMessage(const QByteArray &message, int messageCode);
+
+    /** Activate window requested by server (default implementation does nothing). */
+    virtual void activateWindow(const QByteArray &message);
+
 signals:
     void sendMessageRequest(const QByteArray &message, int messageCode);
 
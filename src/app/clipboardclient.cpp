@@ -21,13 +21,11 @@
 
 #include "common/arguments.h"
 #include "common/client_server.h"
-#include "common/commandstatus.h"
 #include "common/log.h"
 #include "platform/platformnativeinterface.h"
 #include "platform/platformwindow.h"
 
 #include <QCoreApplication>
-#include <QFile>
 
 ClipboardClient::ClipboardClient(int &argc, char **argv, int skipArgc, const QString &sessionName)
     : Client()
@@ -44,28 +42,17 @@ ClipboardClient::ClipboardClient(int &argc, char **argv, int skipArgc, const QSt
 
 void ClipboardClient::onMessageReceived(const QByteArray &data, int messageCode)
 {
-    if (messageCode == CommandActivateWindow) {
-        COPYQ_LOG("Activating window.");
-        PlatformWindowPtr window = createPlatformNativeInterface()->deserialize(data);
-        if (window)
-            window->raise();
-    } else if (messageCode == CommandReadInput) {
-        COPYQ_LOG("Sending standard input.");
-        QFile in;
-        in.open(stdin, QIODevice::ReadOnly);
-        sendMessage( in.readAll(), 0 );
-    } else {
-        QFile f;
-        f.open((messageCode == CommandSuccess || messageCode == CommandFinished) ? stdout : stderr, QIODevice::WriteOnly);
-        f.write(data);
-    }
-
-    COPYQ_LOG( QString("Message received with exit code %1.").arg(messageCode) );
-
-    if (messageCode == CommandFinished || messageCode == CommandBadSyntax || messageCode == CommandError)
+    if ( handleCommandMessage(data, messageCode) )
         exit(messageCode);
 }
 
+void ClipboardClient::activateWindow(const QByteArray &message)
+{
+    PlatformWindowPtr window = createPlatformNativeInterface()->deserialize(message);
+    if (window)
+        window->raise();
+}
+
 void ClipboardClient::onDisconnected()
 {
     if ( wasClosed() )
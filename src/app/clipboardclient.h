@@ -39,6 +39,9 @@ public:
     ClipboardClient(int &argc, char **argv,
                     int skipArgc = 0, const QString &sessionName = QString());
 
+protected:
+    void activateWindow(const QByteArray &message);
+
 private slots:
     void onMessageReceived(const QByteArray &data, int messageCode);
 
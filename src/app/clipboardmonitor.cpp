@@ -20,6 +20,8 @@
 #include "clipboardmonitor.h"
 
 #include "common/arguments.h"
+#include "common/client_server.h"
+#include "common/common.h"
 #include "common/log.h"
 #include "common/mimetypes.h"
 #include "common/monitormessagecode.h"
@@ -27,11 +29,52 @@
 #include "platform/platformclipboard.h"
 
 #include <QApplication>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QSharedMemory>
+#include <QTimer>
+
+#include <cstring>
+
+namespace {
+
+/**
+ * For clipboard data bigger than this, only hash is sent at first
+ * and server requests the data only if it doesn't have them already.
+ */
+const int clipboardHashThreshold = 64 * 1024;
+
+/// Clipboard data bigger than this are sent to server in shared memory.
+const int sharedDataThreshold = 1024 * 1024;
+
+/// Release shared memory if server doesn't read it in given time (in ms).
+const int sharedDataTimeoutMs = 30000;
+
+QString newSharedMemoryKey()
+{
+    static int sharedMemoryId = 0;
+    return serverName( "d" + QString::number(QCoreApplication::applicationPid())
+                       + "_" + QString::number(++sharedMemoryId) );
+}
+
+int dataSize(const QVariantMap &data)
+{
+    int size = 0;
+    foreach (const QVariant &value, data)
+        size += value.toByteArray().size();
+    return size;
+}
+
+} // namespace
 
 ClipboardMonitor::ClipboardMonitor(int &argc, char **argv)
     : Client()
     , App(createPlatformNativeInterface()->createMonitorApplication(argc, argv))
     , m_clipboard(createPlatformNativeInterface()->clipboard())
+    , m_formats()
+    , m_sharedData()
+    , m_pendingClipboardData()
+    , m_lastClipboardDataId(0)
 {
     Q_ASSERT(argc == 3);
     const QString serverName( QString::fromUtf8(argv[2]) );
@@ -54,6 +97,14 @@ void ClipboardMonitor::onClipboardChanged(PlatformClipboard::Mode mode)
     if (mode != PlatformClipboard::Clipboard)
         data.insert(mimeClipboardMode, PlatformClipboard::Selection ? "selection" : "find buffer");
 
+    // Data of same mode waiting for server reply would be stored after newer clipboard data.
+    const QVariant clipboardMode = data.value(mimeClipboardMode);
+    QMutableMapIterator<qint32, QVariantMap> it(m_pendingClipboardData);
+    while ( it.hasNext() ) {
+        if ( it.next().value().value(mimeClipboardMode) == clipboardMode )
+            it.remove();
+    }
+
     // add window title of clipboard owner
     if ( !data.contains(mimeOwner) && !data.contains(mimeWindowTitle) ) {
         PlatformPtr platform = createPlatformNativeInterface();
@@ -62,7 +113,10 @@ void ClipboardMonitor::onClipboardChanged(PlatformClipboard::Mode mode)
             data.insert( mimeWindowTitle, currentWindow->getTitle().toUtf8() );
     }
 
-    sendMessage( serializeData(data), MonitorClipboardChanged );
+    if ( dataSize(data) >= clipboardHashThreshold )
+        sendClipboardHash(data);
+    else
+        sendClipboardData(data);
 }
 
 void ClipboardMonitor::onMessageReceived(const QByteArray &message, int messageCode)
@@ -94,6 +148,18 @@ void ClipboardMonitor::onMessageReceived(const QByteArray &message, int messageC
         m_clipboard->loadSettings(settings);
 
         COPYQ_LOG("Configured");
+    } else if (messageCode == MonitorClipboardDataNeeded) {
+        QDataStream stream(message);
+        qint32 id;
+        bool needed;
+        stream >> id >> needed;
+        const QVariantMap data = m_pendingClipboardData.take(id);
+        if ( needed && !data.isEmpty() )
+            sendClipboardData(data);
+        else if (needed)
+            COPYQ_LOG("Dropping outdated clipboard data.");
+    } else if (messageCode == MonitorReleaseSharedData) {
+        m_sharedData.remove( QString::fromUtf8(message) );
     } else if (messageCode == MonitorChangeClipboard
             || messageCode == MonitorChangeSelection
             || messageCode == MonitorChangeClipboardAndSelection) {
@@ -110,5 +176,79 @@ void ClipboardMonitor::onMessageReceived(const QByteArray &message, int messageC
 
 void ClipboardMonitor::onDisconnected()
 {
+    m_sharedData.clear();
     exit(0);
 }
+
+void ClipboardMonitor::onSharedDataTimeout()
+{
+    QObject *timer = sender();
+    Q_ASSERT(timer);
+    timer->deleteLater();
+
+    // Shared memory keys are unique so the memory could have been released already.
+    const QString key = timer->property("CopyQ_shared_memory_key").toString();
+    if ( m_sharedData.remove(key) > 0 )
+        COPYQ_LOG( QString("Released shared memory \"%1\" not read by server.").arg(key) );
+}
+
+void ClipboardMonitor::sendClipboardHash(const QVariantMap &data)
+{
+    QMap<QString, QByteArray> digests;
+    QVariantMap metadata;
+    foreach ( const QString &mime, data.keys() ) {
+        if ( isClipboardMetadataFormat(mime) ) {
+            metadata.insert( mime, data[mime] );
+        } else {
+            digests.insert( mime, QCryptographicHash::hash(
+                                data[mime].toByteArray(), QCryptographicHash::Sha1) );
+        }
+    }
+
+    const qint32 id = ++m_lastClipboardDataId;
+    m_pendingClipboardData.insert(id, data);
+
+    QByteArray message;
+    QDataStream out(&message, QIODevice::WriteOnly);
+    out << id << static_cast<quint32>( hash(data) ) << digests << metadata;
+    sendMessage(message, MonitorClipboardChangedHash);
+}
+
+void ClipboardMonitor::sendClipboardData(const QVariantMap &data)
+{
+    // Avoid compressing and copying big data through socket.
+    if ( dataSize(data) >= sharedDataThreshold ) {
+        const QByteArray bytes = serializeData(data, false);
+        if ( !sendSharedData(bytes) )
+            sendMessage(bytes, MonitorClipboardChanged);
+        return;
+    }
+
+    sendMessage( serializeData(data), MonitorClipboardChanged );
+}
+
+bool ClipboardMonitor::sendSharedData(const QByteArray &bytes)
+{
+    QSharedPointer<QSharedMemory> sharedMemory( new QSharedMemory(newSharedMemoryKey()) );
+    if ( !sharedMemory->create(bytes.size()) ) {
+        log( QString("Failed to create shared memory: %1").arg(sharedMemory->errorString()),
+             LogWarning );
+        return false;
+    }
+
+    std::memcpy( sharedMemory->data(), bytes.constData(), bytes.size() );
+    m_sharedData.insert( sharedMemory->key(), sharedMemory );
+
+    QTimer *timer = new QTimer(this);
+    timer->setProperty( "CopyQ_shared_memory_key", sharedMemory->key() );
+    timer->setSingleShot(true);
+    connect( timer, SIGNAL(timeout()), SLOT(onSharedDataTimeout()) );
+    timer->start(sharedDataTimeoutMs);
+
+    QByteArray message;
+    QDataStream out(&message, QIODevice::WriteOnly);
+    out << sharedMemory->key() << static_cast<qint32>(bytes.size());
+    sendMessage(message, MonitorClipboardChangedShared);
+
+    return true;
+}
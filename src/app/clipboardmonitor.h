@@ -25,6 +25,12 @@
 
 #include "platform/platformnativeinterface.h"
 
+#include <QMap>
+#include <QSharedPointer>
+#include <QVariantMap>
+
+class QSharedMemory;
+
 /**
  * Monitors clipboard and sends new clipboard data to server.
  * Server can send back new data for clipboard.
@@ -48,9 +54,30 @@ private slots:
 
     void onDisconnected();
 
+    void onSharedDataTimeout();
+
 private:
+    /**
+     * Send only hash, SHA-1 digest of each format and metadata of clipboard data.
+     * Whole data are sent later only if server requests them and clipboard
+     * hasn't changed in the meantime.
+     */
+    void sendClipboardHash(const QVariantMap &data);
+
+    void sendClipboardData(const QVariantMap &data);
+
+    /**
+     * Send serialized clipboard data in shared memory.
+     * Shared memory is kept until server sends MonitorReleaseSharedData,
+     * disconnects or doesn't read the data in time.
+     */
+    bool sendSharedData(const QByteArray &bytes);
+
     PlatformClipboardPtr m_clipboard;
     QStringList m_formats;
+    QMap< QString, QSharedPointer<QSharedMemory> > m_sharedData;
+    QMap<qint32, QVariantMap> m_pendingClipboardData;
+    qint32 m_lastClipboardDataId;
 };
 
 #endif // CLIPBOARDMONITOR_H
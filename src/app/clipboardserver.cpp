@@ -23,6 +23,8 @@
 #include "common/arguments.h"
 #include "common/clientsocket.h"
 #include "common/client_server.h"
+#include "common/commandstatus.h"
+#include "common/common.h"
 #include "common/log.h"
 #include "common/mimetypes.h"
 #include "common/monitormessagecode.h"
@@ -38,6 +40,7 @@
 
 #include <QAction>
 #include <QApplication>
+#include <QCryptographicHash>
 #include <QDateTime>
 #include <QKeyEvent>
 #include <QMenu>
@@ -61,6 +64,38 @@ QString newClipboardMonitorServerName()
                        + QString::number(QDateTime::currentMSecsSinceEpoch()) );
 }
 
+/**
+ * Return true only if item contains same formats as clipboard
+ * with same data (compared using SHA-1 @a digests).
+ */
+bool hasSameData(const QVariantMap &itemData, const QMap<QString, QByteArray> &digests)
+{
+    int formatCount = 0;
+    foreach ( const QString &mime, itemData.keys() ) {
+        if ( isClipboardMetadataFormat(mime) )
+            continue;
+
+        const QMap<QString, QByteArray>::const_iterator it = digests.constFind(mime);
+        if ( it == digests.constEnd() )
+            return false;
+
+        const QByteArray digest =
+                QCryptographicHash::hash(itemData[mime].toByteArray(), QCryptographicHash::Sha1);
+        if ( it.value() != digest )
+            return false;
+
+        ++formatCount;
+    }
+
+    return formatCount == digests.size();
+}
+
+bool isMultiplexedSession(const Arguments &args)
+{
+    return args.length() == Arguments::Rest + 1
+            && args.at(Arguments::Rest) == multiplexedSessionArgument().toUtf8();
+}
+
 } // namespace
 
 ClipboardServer::ClipboardServer(int &argc, char **argv, const QString &sessionName)
@@ -116,6 +151,9 @@ ClipboardServer::ClipboardServer(int &argc, char **argv, const QString &sessionN
 
     // Allow to run at least few client and internal threads concurrently.
     m_clientThreads.setMaxThreadCount( qMax(m_clientThreads.maxThreadCount(), 8) );
+    // Keep idle threads for a while so their initialized script engines can be reused
+    // (engine is destroyed with its thread).
+    m_clientThreads.setExpiryTimeout(60000);
 
     // run clipboard monitor
     startMonitoring();
@@ -156,6 +194,8 @@ void ClipboardServer::startMonitoring()
         m_monitor = new RemoteProcess(this);
         connect( m_monitor, SIGNAL(newMessage(QByteArray)),
                  this, SLOT(newMonitorMessage(QByteArray)) );
+        connect( m_monitor, SIGNAL(newHashMessage(QByteArray)),
+                 this, SLOT(newMonitorHashMessage(QByteArray)) );
         connect( m_monitor, SIGNAL(connectionError()),
                  this, SLOT(monitorConnectionError()) );
         connect( m_monitor, SIGNAL(connected()),
@@ -260,6 +300,19 @@ void ClipboardServer::onIgnoreKeysTimeout()
     m_wnd->setEnabled(true);
 }
 
+void ClipboardServer::startMultiplexedSession(ClientSocket *client)
+{
+    COPYQ_LOG("Starting multiplexed client session.");
+
+    connect( client, SIGNAL(messageReceived(QByteArray,int)),
+             this, SLOT(onMultiplexedCommand(QByteArray)) );
+    connect( this, SIGNAL(terminateClientThreads()),
+             client, SLOT(close()) );
+
+    client->deleteAfterDisconnected();
+    client->start();
+}
+
 bool ClipboardServer::askToQuit()
 {
     if ( m_clientThreads.activeThreadCount() > 0 || m_wnd->hasRunningAction() ) {
@@ -279,6 +332,11 @@ bool ClipboardServer::askToQuit()
 
 void ClipboardServer::doCommand(const Arguments &args, ClientSocket *client)
 {
+    if ( client && isMultiplexedSession(args) ) {
+        startMultiplexedSession(client);
+        return;
+    }
+
     // Worker object without parent needs to be deleted afterwards!
     // There is no parent so as it's possible to move the worker to another thread.
     // QThreadPool takes ownership and worker will be automatically deleted
@@ -293,6 +351,40 @@ void ClipboardServer::doCommand(const Arguments &args, ClientSocket *client)
     m_clientThreads.start(worker);
 }
 
+void ClipboardServer::onMultiplexedCommand(const QByteArray &message)
+{
+    ClientSocket *client = qobject_cast<ClientSocket*>(sender());
+    Q_ASSERT(client);
+
+    QDataStream input(message);
+    qint32 requestId;
+    input >> requestId;
+
+    if ( input.status() != QDataStream::Ok ) {
+        // Request cannot be answered so close whole session instead of leaving client waiting.
+        log( tr("Failed to read command from client!"), LogError );
+        client->close();
+        return;
+    }
+
+    Arguments args;
+    input >> args;
+
+    ClientSocket *channel = client->createChannel(requestId);
+
+    // Each request needs to be answered otherwise client waits indefinitely.
+    if ( input.status() != QDataStream::Ok || args.length() <= Arguments::Rest
+         || isMultiplexedSession(args) )
+    {
+        log( tr("Failed to read command from client!"), LogError );
+        channel->sendMessage( tr("Bad command syntax!").toUtf8() + "\n", CommandBadSyntax );
+        channel->deleteAfterDisconnected();
+        return;
+    }
+
+    doCommand(args, channel);
+}
+
 void ClipboardServer::newMonitorMessage(const QByteArray &message)
 {
     if ( m_wnd->isClipboardStoringDisabled() )
@@ -308,6 +400,43 @@ void ClipboardServer::newMonitorMessage(const QByteArray &message)
     m_wnd->clipboardChanged(data);
 }
 
+void ClipboardServer::newMonitorHashMessage(const QByteArray &message)
+{
+    QDataStream input(message);
+    qint32 id;
+    quint32 itemHash;
+    QMap<QString, QByteArray> digests;
+    QVariantMap metadata;
+    input >> id >> itemHash >> digests >> metadata;
+
+    if ( input.status() != QDataStream::Ok ) {
+        log("Failed to read message from monitor.", LogError);
+        return;
+    }
+
+    bool needed = false;
+
+    if ( !m_wnd->isClipboardStoringDisabled() ) {
+        QVariantMap data = m_wnd->firstTabItemData(itemHash);
+        if ( !data.isEmpty() && hasSameData(data, digests) ) {
+            COPYQ_LOG("Clipboard data already stored.");
+            foreach ( const QString &mime, data.keys() ) {
+                if ( isClipboardMetadataFormat(mime) )
+                    data.remove(mime);
+            }
+            data.unite(metadata);
+            m_wnd->clipboardChanged(data);
+        } else {
+            needed = true;
+        }
+    }
+
+    QByteArray reply;
+    QDataStream out(&reply, QIODevice::WriteOnly);
+    out << id << needed;
+    m_monitor->writeMessage(reply, MonitorClipboardDataNeeded);
+}
+
 void ClipboardServer::monitorConnectionError()
 {
     stopMonitoring();
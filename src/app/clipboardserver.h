@@ -94,9 +94,18 @@ private slots:
             ClientSocket *client = NULL //!< For sending responses.
             );
 
+    /** New command from client in multiplexed session. */
+    void onMultiplexedCommand(const QByteArray &message);
+
     /** New message from monitor process. */
     void newMonitorMessage(const QByteArray &message);
 
+    /**
+     * Monitor sent hash of new clipboard; reply whether whole data are needed
+     * or use data of existing item.
+     */
+    void newMonitorHashMessage(const QByteArray &message);
+
     /** An error occurred on monitor connection. */
     void monitorConnectionError();
 
@@ -124,6 +133,9 @@ private:
     /** Ask to cancel application exit if there are any active commands. */
     bool askToQuit();
 
+    /** Keep client connected and run each received command in separate channel. */
+    void startMultiplexedSession(ClientSocket *client);
+
     MainWindow* m_wnd;
     RemoteProcess *m_monitor;
     QMap<QxtGlobalShortcut*, Command> m_shortcutActions;
@@ -0,0 +1,244 @@
+/*
+    Copyright (c) 2014, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "multiplexedclient.h"
+
+#include "common/arguments.h"
+#include "common/client_server.h"
+#include "common/commandstatus.h"
+#include "common/log.h"
+#include "platform/platformnativeinterface.h"
+#include "platform/platformwindow.h"
+
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QThread>
+
+namespace {
+
+// Arguments are read in chunks so bad LENGTH in header doesn't allocate too much memory.
+const qint64 readChunkSize = 64 * 1024;
+
+bool readNumbers(const QByteArray &line, QList<int> *numbers)
+{
+    const QList<QByteArray> values = line.trimmed().split(' ');
+    bool ok = true;
+    foreach (const QByteArray &value, values) {
+        numbers->append( value.toInt(&ok) );
+        if (!ok)
+            return false;
+    }
+
+    return true;
+}
+
+bool readExactly(QIODevice *input, qint64 size, QByteArray *bytes)
+{
+    bytes->clear();
+    qint64 read = 0;
+    while (read < size) {
+        const int chunkSize = static_cast<int>( qMin(readChunkSize, size - read) );
+        bytes->resize( bytes->size() + chunkSize );
+        qint64 chunkRead = 0;
+        while (chunkRead < chunkSize) {
+            const qint64 n = input->read(bytes->data() + read + chunkRead, chunkSize - chunkRead);
+            if (n <= 0)
+                return false;
+            chunkRead += n;
+        }
+        read += chunkRead;
+    }
+
+    return true;
+}
+
+/**
+ * Reads commands from standard input in separate thread (reading is blocking).
+ */
+class CommandReader : public QObject
+{
+    Q_OBJECT
+
+public slots:
+    void readCommands()
+    {
+        QFile input;
+        input.open(stdin, QIODevice::ReadOnly);
+
+        bool ok = true;
+        while ( readCommand(&input, &ok) ) {}
+
+        emit finished(ok);
+    }
+
+signals:
+    void commandRead(int requestId, const Arguments &arguments);
+    void finished(bool ok);
+
+private:
+    /** Return false at end of input; @a ok is set to false if input is malformed. */
+    bool readCommand(QIODevice *input, bool *ok)
+    {
+        const QByteArray line = input->readLine();
+        if ( line.isEmpty() )
+            return false; // end of input
+
+        QList<int> header;
+        if ( !readNumbers(line, &header) || header.size() != 2 || header[1] < 0 ) {
+            log( tr("Bad command header!"), LogError );
+            *ok = false;
+            return false;
+        }
+
+        const int requestId = header[0];
+        Arguments arguments;
+        for (int i = 0; i < header[1]; ++i) {
+            QList<int> length;
+            QByteArray argument;
+            QByteArray separator;
+            if ( !readNumbers(input->readLine(), &length) || length.size() != 1 || length[0] < 0
+                 || !readExactly(input, length[0], &argument)
+                 || !readExactly(input, 1, &separator) || separator != "\n" )
+            {
+                log( tr("Bad command argument!"), LogError );
+                *ok = false;
+                return false;
+            }
+            arguments.append(argument);
+        }
+
+        emit commandRead(requestId, arguments);
+        return true;
+    }
+};
+
+} // namespace
+
+MultiplexedClient::MultiplexedClient(int &argc, char **argv, const QString &sessionName)
+    : Client()
+    , App(createPlatformNativeInterface()->createClientApplication(argc, argv), sessionName)
+    , m_output()
+    , m_pendingRequests()
+    , m_inputFinished(false)
+    , m_exitCode(0)
+{
+    m_output.open(stdout, QIODevice::WriteOnly);
+
+    Arguments arguments;
+    arguments.append( multiplexedSessionArgument().toUtf8() );
+    if ( !startClientSocket(clipboardServerName(), arguments) ) {
+        log( tr("Cannot connect to server! Start CopyQ server first."), LogError );
+        exit(1);
+        return;
+    }
+
+    qRegisterMetaType<Arguments>("Arguments");
+
+    CommandReader *reader = new CommandReader;
+    QThread *t = new QThread;
+    connect(reader, SIGNAL(finished(bool)), t, SLOT(quit()));
+    connect(t, SIGNAL(finished()), reader, SLOT(deleteLater()));
+    connect(t, SIGNAL(finished()), t, SLOT(deleteLater()));
+    reader->moveToThread(t);
+
+    connect( reader, SIGNAL(commandRead(int,Arguments)),
+             this, SLOT(onCommandRead(int,Arguments)) );
+    connect( reader, SIGNAL(finished(bool)),
+             this, SLOT(onInputFinished(bool)) );
+
+    t->start();
+    QMetaObject::invokeMethod(reader, "readCommands", Qt::QueuedConnection);
+}
+
+void MultiplexedClient::onMessageReceived(const QByteArray &data, int messageCode)
+{
+    QDataStream input(data);
+    qint32 requestId;
+    input >> requestId;
+    const int i = sizeof(requestId);
+    const QByteArray message( data.constData() + i, data.length() - i );
+
+    COPYQ_LOG( QString("Message received for request %1 with exit code %2.")
+               .arg(requestId).arg(messageCode) );
+
+    if (messageCode == CommandActivateWindow) {
+        PlatformWindowPtr window = createPlatformNativeInterface()->deserialize(message);
+        if (window)
+            window->raise();
+        return;
+    }
+
+    writeResponse(requestId, messageCode, message);
+
+    if (messageCode != CommandSuccess) {
+        m_pendingRequests.remove(requestId);
+        exitIfFinished();
+    }
+}
+
+void MultiplexedClient::onDisconnected()
+{
+    if ( wasClosed() )
+        return;
+
+    log( tr("Connection lost!"), LogError );
+    exit(1);
+}
+
+void MultiplexedClient::onCommandRead(int requestId, const Arguments &arguments)
+{
+    // Responses for requests with same ID couldn't be distinguished.
+    if ( m_pendingRequests.contains(requestId) ) {
+        const QString error = tr("Request with ID %1 is already running!").arg(requestId);
+        log(error, LogError);
+        writeResponse( requestId, CommandBadSyntax, error.toUtf8() + "\n" );
+        return;
+    }
+
+    m_pendingRequests.insert(requestId);
+
+    QByteArray msg;
+    QDataStream out(&msg, QIODevice::WriteOnly);
+    out << static_cast<qint32>(requestId) << arguments;
+    sendMessage(msg, 0);
+}
+
+void MultiplexedClient::onInputFinished(bool ok)
+{
+    m_inputFinished = true;
+    if (!ok)
+        m_exitCode = CommandBadSyntax;
+    exitIfFinished();
+}
+
+void MultiplexedClient::writeResponse(int requestId, int messageCode, const QByteArray &message)
+{
+    m_output.write( QString("%1 %2 %3\n").arg(requestId).arg(messageCode).arg(message.size()).toUtf8() );
+    m_output.write(message);
+    m_output.write("\n");
+    m_output.flush();
+}
+
+void MultiplexedClient::exitIfFinished()
+{
+    if (m_inputFinished && m_pendingRequests.isEmpty())
+        exit(m_exitCode);
+}
+
+#include "multiplexedclient.moc"
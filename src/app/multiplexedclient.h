@@ -0,0 +1,72 @@
+/*
+    Copyright (c) 2014, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MULTIPLEXEDCLIENT_H
+#define MULTIPLEXEDCLIENT_H
+
+#include "app.h"
+#include "client.h"
+
+#include <QFile>
+#include <QSet>
+
+class Arguments;
+
+/**
+ * Client which keeps single connection to server and runs many commands.
+ *
+ * Commands are read from standard input and are executed concurrently by server.
+ * Each command starts with line "ID ARGC" followed by ARGC arguments each in format
+ * "LENGTH\n" + bytes + "\n".
+ *
+ * Responses are printed on standard output (possibly in different order than commands)
+ * in format "ID STATUS LENGTH\n" + bytes + "\n" where STATUS is CommandStatus.
+ * Status CommandSuccess is partial output, any other status finishes the command.
+ *
+ * Client exits after standard input is closed and all commands are finished.
+ * Exit code is non-zero if input is malformed.
+ */
+class MultiplexedClient : public Client, public App
+{
+    Q_OBJECT
+
+public:
+    MultiplexedClient(int &argc, char **argv, const QString &sessionName = QString());
+
+private slots:
+    void onMessageReceived(const QByteArray &data, int messageCode);
+
+    void onDisconnected();
+
+    void onCommandRead(int requestId, const Arguments &arguments);
+
+    void onInputFinished(bool ok);
+
+private:
+    void writeResponse(int requestId, int messageCode, const QByteArray &message);
+
+    void exitIfFinished();
+
+    QFile m_output;
+    QSet<int> m_pendingRequests;
+    bool m_inputFinished;
+    int m_exitCode;
+};
+
+#endif // MULTIPLEXEDCLIENT_H
@@ -29,7 +29,9 @@
 
 #include <QCoreApplication>
 #include <QByteArray>
+#include <QDataStream>
 #include <QProcess>
+#include <QSharedMemory>
 #include <QString>
 
 RemoteProcess::RemoteProcess(QObject *parent)
@@ -134,6 +136,10 @@ void RemoteProcess::onMessageReceived(const QByteArray &message, int messageCode
         log( QString::fromUtf8(message).trimmed(), LogNote );
     } else if (messageCode == MonitorClipboardChanged) {
         emit newMessage(message);
+    } else if (messageCode == MonitorClipboardChangedShared) {
+        readSharedData(message);
+    } else if (messageCode == MonitorClipboardChangedHash) {
+        emit newHashMessage(message);
     } else {
         log( QString("Unknown message code %1 from remote process!").arg(messageCode), LogError );
     }
@@ -171,3 +177,29 @@ void RemoteProcess::pongTimeout()
     log( "Remote process: Connection timeout!", LogError );
     onConnectionError();
 }
+
+void RemoteProcess::readSharedData(const QByteArray &message)
+{
+    QDataStream input(message);
+    QString key;
+    qint32 size;
+    input >> key >> size;
+
+    if ( input.status() != QDataStream::Ok ) {
+        log( "Failed to read shared memory key from remote process!", LogError );
+        return;
+    }
+
+    QSharedMemory sharedMemory(key);
+    if ( sharedMemory.attach(QSharedMemory::ReadOnly) && sharedMemory.size() >= size ) {
+        // Data are copied only once while deserializing.
+        const char *data = static_cast<const char *>( sharedMemory.constData() );
+        emit newMessage( QByteArray::fromRawData(data, size) );
+        sharedMemory.detach();
+    } else {
+        log( QString("Failed to read shared memory from remote process: %1")
+             .arg(sharedMemory.errorString()), LogError );
+    }
+
+    writeMessage( key.toUtf8(), MonitorReleaseSharedData );
+}
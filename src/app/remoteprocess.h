@@ -58,9 +58,18 @@ public:
 signals:
     /**
      * Remote processed sends @a message.
+     *
+     * Message can reference shared memory which is released after the signal is handled
+     * (so the message must not be passed using queued connection).
      */
     void newMessage(const QByteArray &message);
 
+    /**
+     * Remote processed sends hash, format sizes and metadata of new clipboard
+     * (see MonitorClipboardChangedHash).
+     */
+    void newHashMessage(const QByteArray &message);
+
     /**
      * Sends message to monitor.
      */
@@ -85,6 +94,9 @@ private slots:
     void onConnectionError();
 
 private:
+    /** Emit newMessage() with data from shared memory and let remote process release it. */
+    void readSharedData(const QByteArray &message);
+
     QTimer m_timerPing;
     QTimer m_timerPongTimeout;
     enum State {
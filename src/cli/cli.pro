@@ -0,0 +1,29 @@
+include("../../common.pri")
+
+# Lean console client which links only QtCore and QtNetwork.
+TEMPLATE = app
+
+TARGET = ../../copyq-cli
+CONFIG += console
+CONFIG -= app_bundle
+QT = core network
+INCLUDEPATH += $$PWD/..
+
+CONFIG(debug, debug|release) {
+    DEFINES += HAS_TESTS COPYQ_DEBUG
+}
+
+HEADERS += \
+    ../app/client.h \
+    ../common/arguments.h \
+    ../common/client_server.h \
+    ../common/clientsocket.h \
+    ../common/commandstatus.h \
+    ../common/log.h
+SOURCES += \
+    main.cpp \
+    ../app/client.cpp \
+    ../common/arguments.cpp \
+    ../common/client_server.cpp \
+    ../common/clientsocket.cpp \
+    ../common/log.cpp
@@ -0,0 +1,130 @@
+/*
+    Copyright (c) 2014, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "app/client.h"
+#include "common/arguments.h"
+#include "common/client_server.h"
+#include "common/log.h"
+
+#include <QCoreApplication>
+#include <QProcess>
+#include <QStringList>
+
+namespace {
+
+/**
+ * Path to full application binary which is used to activate windows.
+ */
+QString guiApplicationPath()
+{
+#ifdef Q_OS_WIN
+    return QCoreApplication::applicationDirPath() + "/copyq.exe";
+#else
+    return QCoreApplication::applicationDirPath() + "/copyq";
+#endif
+}
+
+/**
+ * Lean client which uses only QtCore and QtNetwork.
+ *
+ * Same as ClipboardClient but doesn't load GUI libraries.
+ * Activating windows is delegated to full application binary.
+ */
+class ConsoleClient : public Client
+{
+    Q_OBJECT
+
+public:
+    ConsoleClient()
+        : Client()
+        , m_closed(false)
+    {
+    }
+
+    bool start(const Arguments &arguments)
+    {
+        return startClientSocket(clipboardServerName(), arguments);
+    }
+
+private slots:
+    void onMessageReceived(const QByteArray &data, int messageCode)
+    {
+        if ( handleCommandMessage(data, messageCode) )
+            exit(messageCode);
+    }
+
+    void onDisconnected()
+    {
+        if (m_closed)
+            return;
+
+        log( tr("Connection lost!"), LogError );
+        exit(1);
+    }
+
+protected:
+    void activateWindow(const QByteArray &message)
+    {
+        QProcess::execute( guiApplicationPath(),
+                           QStringList() << activateWindowArgument()
+                                         << QString::fromLatin1(message.toBase64()) );
+    }
+
+private:
+    void exit(int exitCode)
+    {
+        if (m_closed)
+            return;
+
+        m_closed = true;
+        QCoreApplication::exit(exitCode);
+    }
+
+    bool m_closed;
+};
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+
+    const QStringList arguments = app.arguments().mid(1);
+
+    int skipArguments;
+    const QString sessionName = getSessionName(arguments, &skipArguments);
+    if ( !isValidSessionName(sessionName) ) {
+        log( QObject::tr("Session name must contain at most 16 characters\n"
+                         "which can be letters, digits, '-' or '_'!"), LogError );
+        return 2;
+    }
+
+    // Server name depends on application name (same as in App).
+    initSession(sessionName);
+
+    ConsoleClient client;
+    if ( !client.start(Arguments(arguments.mid(skipArguments))) ) {
+        log( QObject::tr("Cannot connect to server! Start CopyQ server first."), LogError );
+        return 1;
+    }
+
+    return app.exec();
+}
+
+#include "main.moc"
@@ -21,8 +21,23 @@
 
 #include <QCoreApplication>
 #include <QString>
+#include <QStringList>
 #include <QtGlobal>
 
+namespace {
+
+bool containsOnlyValidCharacters(const QString &sessionName)
+{
+    foreach (const QChar &c, sessionName) {
+        if ( !c.isLetterOrNumber() && c != '-' && c != '_' )
+            return false;
+    }
+
+    return true;
+}
+
+} // namespace
+
 QString serverName(const QString &name)
 {
     // applicationName changes case depending on whether this is a GUI app
@@ -40,3 +55,56 @@ QString clipboardServerName()
 {
     return serverName("s");
 }
+
+QString multiplexedSessionArgument()
+{
+    return "--multiplex";
+}
+
+QString activateWindowArgument()
+{
+    return "--activate-window";
+}
+
+void initSession(const QString &sessionName)
+{
+    QString session("copyq");
+    if ( !sessionName.isEmpty() )
+        session += "-" + sessionName;
+
+#ifdef HAS_TESTS
+    if ( !qgetenv("COPYQ_TEST_ID").isEmpty() )
+        session += ".test";
+#endif
+
+    QCoreApplication::setOrganizationName(session);
+    QCoreApplication::setApplicationName(session);
+
+    qputenv("COPYQ_SESSION_NAME", sessionName.toUtf8());
+    qputenv("COPYQ", QCoreApplication::applicationFilePath().toUtf8());
+}
+
+bool isValidSessionName(const QString &sessionName)
+{
+    return !sessionName.isNull() &&
+           sessionName.length() < 16 &&
+           containsOnlyValidCharacters(sessionName);
+}
+
+QString getSessionName(const QStringList &arguments, int *skipArguments)
+{
+    const QString firstArgument = arguments.value(0);
+    *skipArguments = 0;
+
+    if (firstArgument == "-s" || firstArgument == "--session" || firstArgument == "session") {
+        *skipArguments = 2;
+        return arguments.value(1);
+    }
+
+    if ( firstArgument.startsWith("--session=") ) {
+        *skipArguments = 1;
+        return firstArgument.mid( firstArgument.indexOf('=') + 1 );
+    }
+
+    return QString::fromUtf8( qgetenv("COPYQ_SESSION_NAME") );
+}
@@ -21,8 +21,31 @@
 #define CLIENT_SERVER_H
 
 class QString;
+class QStringList;
 
 QString serverName(const QString &name);
 QString clipboardServerName();
 
+/** Argument sent by client to start multiplexed session (see MultiplexedClient). */
+QString multiplexedSessionArgument();
+
+/** Argument for raising window (serialized and base64-encoded) by other process. */
+QString activateWindowArgument();
+
+bool isValidSessionName(const QString &sessionName);
+
+/**
+ * Return session name from first command line @a arguments or environment.
+ * Number of arguments with session name is stored in @a skipArguments.
+ */
+QString getSessionName(const QStringList &arguments, int *skipArguments);
+
+/**
+ * Set application name for session (server name depends on it) and environment
+ * for processes started by the session.
+ *
+ * Tests use different application name so they don't interfere with user session.
+ */
+void initSession(const QString &sessionName);
+
 #endif // CLIENT_SERVER_H
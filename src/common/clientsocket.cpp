@@ -19,75 +19,54 @@
 
 #include "clientsocket.h"
 
-#include "common/arguments.h"
 #include "common/client_server.h"
+#include "common/commandstatus.h"
 #include "common/log.h"
 
 #include <QDataStream>
+#include <QElapsedTimer>
+#include <QMutexLocker>
+
+#include <limits>
 
 #define SOCKET_LOG(text) \
     COPYQ_LOG_VERBOSE( QString("Socket %1: %2").arg(property("id").toInt()).arg(text) )
 
 namespace {
 
-bool readBytes(QLocalSocket *socket, qint64 size, QByteArray *bytes)
-{
-    qint64 avail, read = 0;
-    bytes->clear();
-    while (read < size) {
-        if ( socket->bytesAvailable() == 0 && !socket->waitForReadyRead(4000) )
-            return false;
-        avail = qMin( socket->bytesAvailable(), size-read );
-        bytes->append( socket->read(avail) );
-        read += avail;
-    }
-
-    return true;
-}
-
-bool readMessage(QLocalSocket *socket, QByteArray *msg)
-{
-    QByteArray bytes;
-    quint32 len;
-
-    COPYQ_LOG_VERBOSE("Reading message.");
-
-    if ( readBytes(socket, sizeof(len), &bytes) ) {
-        QDataStream(bytes) >> len;
-
-        if ( readBytes(socket, len, msg) ) {
-            COPYQ_LOG_VERBOSE( QString("Message read (%1 bytes).").arg(msg->size()) );
-            return true;
-        }
-    }
-
-    COPYQ_LOG("ERROR: Incorrect message!");
-
-    return false;
-}
-
-bool writeMessage(QLocalSocket *socket, const QByteArray &msg)
-{
-    COPYQ_LOG_VERBOSE( QString("Write message (%1 bytes).").arg(msg.size()) );
+/// Message header contains message length (quint32) followed by message code (qint32).
+const qint64 messageHeaderSize = sizeof(quint32) + sizeof(qint32);
 
-    QDataStream out(socket);
-    // length is serialized as a quint32, followed by msg
-    out.writeBytes( msg.constData(), msg.length() );
+/// Maximum size of received message (checked before allocating memory for it).
+const quint32 maxMessageSize = 256 * 1024 * 1024;
 
-    if (out.status() != QDataStream::Ok) {
-        COPYQ_LOG("Cannot write message!");
-        return false;
-    }
-
-    COPYQ_LOG_VERBOSE("Message written.");
-    return true;
-}
+/**
+ * Maximum number of bytes in socket write buffer.
+ * Rest of the data is written after some bytes are written to the socket.
+ */
+const qint64 maxBytesToWrite = 1024 * 1024;
 
 } //namespace
 
 ClientSocket::ClientSocket()
     : QObject()
     , m_socket()
+    , m_parentSocket()
+    , m_channelId(0)
+    , m_isChannel(false)
+    , m_pendingData()
+    , m_pendingDataOffset(0)
+    , m_queuedBytes(0)
+    , m_pendingBytesMutex()
+    , m_pendingBytesChanged()
+    , m_pendingBytes(0)
+    , m_pendingBytesClosed(false)
+    , m_message()
+    , m_messageBytesRead(0)
+    , m_messageCode(0)
+    , m_hasMessageHeader(false)
+    , m_started(false)
+    , m_receivingArguments(false)
     , m_deleteAfterDisconnected(false)
     , m_closed(true)
 {
@@ -96,6 +75,22 @@ ClientSocket::ClientSocket()
 ClientSocket::ClientSocket(QLocalSocket *socket, QObject *parent)
     : QObject(parent)
     , m_socket(socket)
+    , m_parentSocket()
+    , m_channelId(0)
+    , m_isChannel(false)
+    , m_pendingData()
+    , m_pendingDataOffset(0)
+    , m_queuedBytes(0)
+    , m_pendingBytesMutex()
+    , m_pendingBytesChanged()
+    , m_pendingBytes(0)
+    , m_pendingBytesClosed(false)
+    , m_message()
+    , m_messageBytesRead(0)
+    , m_messageCode(0)
+    , m_hasMessageHeader(false)
+    , m_started(false)
+    , m_receivingArguments(false)
     , m_deleteAfterDisconnected(false)
     , m_closed(false)
 {
@@ -104,6 +99,8 @@ ClientSocket::ClientSocket(QLocalSocket *socket, QObject *parent)
              this, SLOT(onStateChanged(QLocalSocket::LocalSocketState)) );
     connect( m_socket.data(), SIGNAL(error(QLocalSocket::LocalSocketError)),
              this, SLOT(onError(QLocalSocket::LocalSocketError)) );
+    connect( m_socket.data(), SIGNAL(bytesWritten(qint64)),
+             this, SLOT(onBytesWritten()) );
 
     onStateChanged(m_socket->state());
 
@@ -113,6 +110,41 @@ ClientSocket::ClientSocket(QLocalSocket *socket, QObject *parent)
     }
 }
 
+ClientSocket::ClientSocket(ClientSocket *parentSocket, qint32 channelId)
+    : QObject()
+    , m_socket()
+    , m_parentSocket(parentSocket)
+    , m_channelId(channelId)
+    , m_isChannel(true)
+    , m_pendingData()
+    , m_pendingDataOffset(0)
+    , m_queuedBytes(0)
+    , m_pendingBytesMutex()
+    , m_pendingBytesChanged()
+    , m_pendingBytes(0)
+    , m_pendingBytesClosed(false)
+    , m_message()
+    , m_messageBytesRead(0)
+    , m_messageCode(0)
+    , m_hasMessageHeader(false)
+    , m_started(false)
+    , m_receivingArguments(false)
+    , m_deleteAfterDisconnected(false)
+    , m_closed( parentSocket->isClosed() )
+{
+    m_pendingBytesClosed = m_closed;
+
+    connect( parentSocket, SIGNAL(disconnected()),
+             this, SLOT(close()) );
+    connect( parentSocket, SIGNAL(destroyed()),
+             this, SLOT(close()) );
+
+    if ( hasLogLevel(LogDebug) ) {
+        setProperty( "id", parentSocket->property("id") );
+        SOCKET_LOG( QString("Creating channel %1.").arg(channelId) );
+    }
+}
+
 ClientSocket::~ClientSocket()
 {
     SOCKET_LOG("Destroying socket.");
@@ -120,32 +152,62 @@ ClientSocket::~ClientSocket()
 
 void ClientSocket::start()
 {
-    QMetaObject::invokeMethod(this, "onReadyRead", Qt::QueuedConnection);
+    // Channel doesn't receive any messages.
+    if (m_isChannel)
+        return;
+
+    QMetaObject::invokeMethod(this, "onStart", Qt::QueuedConnection);
+}
+
+ClientSocket::WaitResult ClientSocket::waitForPendingBytes(qint64 maxBytes, int timeoutMs)
+{
+    if (m_isChannel) {
+        {
+            QMutexLocker lock(&m_pendingBytesMutex);
+            if (m_pendingBytesClosed)
+                return WaitSocketClosed;
+        }
+
+        ClientSocket *parentSocket = m_parentSocket;
+        return parentSocket ? parentSocket->waitForPendingBytes(maxBytes, timeoutMs)
+                            : WaitSocketClosed;
+    }
+
+    QElapsedTimer t;
+    t.start();
+
+    QMutexLocker lock(&m_pendingBytesMutex);
+    while (!m_pendingBytesClosed && m_pendingBytes > maxBytes) {
+        const qint64 remainingMs = timeoutMs - t.elapsed();
+        if ( remainingMs <= 0
+             || !m_pendingBytesChanged.wait(&m_pendingBytesMutex, static_cast<unsigned long>(remainingMs)) )
+        {
+            if (!m_pendingBytesClosed && m_pendingBytes > maxBytes)
+                return WaitTimedOut;
+        }
+    }
+
+    return m_pendingBytesClosed ? WaitSocketClosed : WaitSucceeded;
+}
+
+ClientSocket *ClientSocket::createChannel(qint32 channelId)
+{
+    return new ClientSocket(this, channelId);
 }
 
 void ClientSocket::sendMessage(const QByteArray &message, int messageCode)
 {
     SOCKET_LOG( QString("Sending message to client (exit code: %1).").arg(messageCode) );
 
-    if ( m_socket.isNull() ) {
-        SOCKET_LOG("Cannot send message to client. Socket is already deleted.");
-    } else if (m_closed) {
-        SOCKET_LOG("Client disconnected!");
-    } else {
-        QByteArray msg;
-        QDataStream out(&msg, QIODevice::WriteOnly);
-        out << (qint32)messageCode;
-        out.writeRawData( message.constData(), message.length() );
-        if ( writeMessage(m_socket, msg) )
-            SOCKET_LOG("Message sent to client.");
-        else
-            SOCKET_LOG("Failed to send message to client!");
-    }
+    if (m_isChannel)
+        sendChannelMessage(message, messageCode);
+    else
+        writeMessage(message, messageCode, QByteArray());
 }
 
 void ClientSocket::deleteAfterDisconnected()
 {
-    if ( m_socket.isNull() ) {
+    if ( !m_isChannel && m_socket.isNull() ) {
         SOCKET_LOG("Socket is already deleted.");
     } else if (m_closed) {
         SOCKET_LOG("Delete after disconnected.");
@@ -158,8 +220,12 @@ void ClientSocket::deleteAfterDisconnected()
 
 void ClientSocket::close()
 {
-    if ( !m_socket.isNull() ) {
+    if (m_isChannel) {
+        SOCKET_LOG( QString("Closing channel %1.").arg(m_channelId) );
+        onStateChanged(QLocalSocket::UnconnectedState);
+    } else if ( !m_socket.isNull() ) {
         SOCKET_LOG("Disconnecting socket.");
+        writePendingData(true);
         m_socket->disconnectFromServer();
     }
 }
@@ -169,6 +235,12 @@ bool ClientSocket::isClosed() const
     return m_closed;
 }
 
+void ClientSocket::onStart()
+{
+    m_started = true;
+    startReading();
+}
+
 void ClientSocket::onReadyRead()
 {
     if ( m_socket.isNull() ) {
@@ -176,32 +248,56 @@ void ClientSocket::onReadyRead()
         return;
     }
 
-    /* QLocalSocket::waitForReadyRead() seems to re-emit readyRead()
-     * though QIODevice::waitForReadyRead() doesn't do that (very confusing).
-     */
-    disconnect( m_socket, SIGNAL(readyRead()),
-                this, SLOT(onReadyRead()) );
-
-    while (m_socket->bytesAvailable() > 0) {
-        QByteArray msg;
+    // Read as much as is available without blocking; the rest of the message
+    // is read when readyRead() is emitted again.
+    while (m_started || m_receivingArguments) {
+        if (!m_hasMessageHeader) {
+            if ( m_socket->bytesAvailable() < messageHeaderSize )
+                return;
+
+            quint32 length;
+            QDataStream stream(m_socket);
+            stream >> length >> m_messageCode;
+            if ( stream.status() != QDataStream::Ok
+                 || length < sizeof(qint32) || length > maxMessageSize )
+            {
+                abortOnReadError();
+                return;
+            }
+
+            // Allocate whole message at once so the data are copied only from socket buffer.
+            m_message.resize( static_cast<int>(length - sizeof(qint32)) );
+            m_messageBytesRead = 0;
+            m_hasMessageHeader = true;
+        }
 
-        if ( !readMessage(m_socket, &msg) ) {
-            log( tr("Failed to read message from client!"), LogError );
-            m_socket->abort();
-            onStateChanged(QLocalSocket::UnconnectedState);
-            return;
+        const qint64 bytesToRead = m_message.size() - m_messageBytesRead;
+        if (bytesToRead > 0) {
+            const qint64 bytesRead =
+                    m_socket->read(m_message.data() + m_messageBytesRead, bytesToRead);
+            if (bytesRead < 0) {
+                abortOnReadError();
+                return;
+            }
+
+            m_messageBytesRead += bytesRead;
+            if (bytesRead < bytesToRead)
+                return;
         }
 
-        QDataStream stream(msg);
-        qint32 messageCode;
-        stream >> messageCode;
-        const int i = sizeof(messageCode);
-        const QByteArray data( msg.constData() + i, msg.length() - i );
-        emit messageReceived(data, messageCode);
+        COPYQ_LOG_VERBOSE( QString("Message read (%1 bytes).").arg(m_message.size()) );
+
+        const QByteArray message = m_message;
+        m_message = QByteArray();
+        m_hasMessageHeader = false;
+        m_receivingArguments = false;
+        emit messageReceived(message, m_messageCode);
     }
+}
 
-    connect( m_socket, SIGNAL(readyRead()),
-             this, SLOT(onReadyRead()) );
+void ClientSocket::onBytesWritten()
+{
+    writePendingData(false);
 }
 
 void ClientSocket::onError(QLocalSocket::LocalSocketError error)
@@ -223,6 +319,10 @@ void ClientSocket::onStateChanged(QLocalSocket::LocalSocketState state)
     if (!m_closed) {
         m_closed = state != QLocalSocket::ConnectedState;
         if (m_closed) {
+            m_pendingData.clear();
+            m_pendingDataOffset = 0;
+            m_queuedBytes = 0;
+            updatePendingBytes();
             emit disconnected();
             if (m_deleteAfterDisconnected)
                 deleteLater();
@@ -230,21 +330,123 @@ void ClientSocket::onStateChanged(QLocalSocket::LocalSocketState state)
     }
 }
 
-Arguments ClientSocket::readArguments()
+void ClientSocket::sendChannelMessage(const QByteArray &message, int messageCode)
 {
-    QByteArray msg;
+    if (m_closed || m_parentSocket.isNull()) {
+        SOCKET_LOG("Client disconnected!");
+        return;
+    }
 
-    if ( readMessage(m_socket, &msg) ) {
-        SOCKET_LOG("Message received from client.");
-        QDataStream input(msg);
-        qint32 exitCode;
-        Arguments args;
-        input >> exitCode >> args;
-        if ( input.status() == QDataStream::Ok && exitCode == 0 && !args.isEmpty() )
-            return args;
+    // Standard input of client is used for sending commands in multiplexed session.
+    if (messageCode == CommandReadInput) {
+        emit messageReceived(QByteArray(), 0);
+        return;
     }
 
-    log( tr("Failed to read message from client!"), LogError );
+    QByteArray channelId;
+    QDataStream out(&channelId, QIODevice::WriteOnly);
+    out << m_channelId;
+    m_parentSocket->writeMessage(message, messageCode, channelId);
+
+    if (messageCode == CommandFinished || messageCode == CommandBadSyntax || messageCode == CommandError)
+        close();
+}
+
+void ClientSocket::writeMessage(const QByteArray &message, int messageCode, const QByteArray &prefix)
+{
+    if ( m_socket.isNull() ) {
+        SOCKET_LOG("Cannot send message to client. Socket is already deleted.");
+        return;
+    }
+
+    if (m_closed) {
+        SOCKET_LOG("Client disconnected!");
+        return;
+    }
+
+    // Header and message are queued separately so the message data
+    // (implicitly shared with sender) are never copied to a bigger buffer.
+    QByteArray header;
+    QDataStream out(&header, QIODevice::WriteOnly);
+    out << static_cast<quint32>( sizeof(qint32) + prefix.size() + message.size() )
+        << static_cast<qint32>(messageCode);
+    header.append(prefix);
+
+    m_pendingData.append(header);
+    if ( !message.isEmpty() )
+        m_pendingData.append(message);
+    m_queuedBytes += header.size() + message.size();
 
-    return Arguments();
+    writePendingData(false);
+}
+
+void ClientSocket::writePendingData(bool writeAll)
+{
+    while ( !m_pendingData.isEmpty() ) {
+        const qint64 bytesFree = writeAll
+                ? std::numeric_limits<int>::max()
+                : maxBytesToWrite - m_socket->bytesToWrite();
+        if (bytesFree <= 0)
+            break;
+
+        const QByteArray &data = m_pendingData.first();
+        const qint64 bytesToWrite = qMin<qint64>(bytesFree, data.size() - m_pendingDataOffset);
+        const qint64 bytesWritten =
+                m_socket->write(data.constData() + m_pendingDataOffset, bytesToWrite);
+
+        if (bytesWritten < 0) {
+            SOCKET_LOG("Failed to send message to client!");
+            m_pendingData.clear();
+            m_pendingDataOffset = 0;
+            m_queuedBytes = 0;
+            break;
+        }
+
+        m_queuedBytes -= bytesWritten;
+        m_pendingDataOffset += static_cast<int>(bytesWritten);
+        if (m_pendingDataOffset == data.size()) {
+            m_pendingData.removeFirst();
+            m_pendingDataOffset = 0;
+        }
+    }
+
+    if ( m_pendingData.isEmpty() )
+        SOCKET_LOG("Message sent to client.");
+
+    updatePendingBytes();
+}
+
+void ClientSocket::updatePendingBytes()
+{
+    QMutexLocker lock(&m_pendingBytesMutex);
+    m_pendingBytes = m_queuedBytes;
+    if ( !m_closed && !m_socket.isNull() )
+        m_pendingBytes += m_socket->bytesToWrite();
+    m_pendingBytesClosed = m_closed;
+    m_pendingBytesChanged.wakeAll();
+}
+
+void ClientSocket::receiveArguments()
+{
+    m_receivingArguments = true;
+    startReading();
+}
+
+void ClientSocket::startReading()
+{
+    if ( m_socket.isNull() ) {
+        SOCKET_LOG("Cannot read message from client. Socket is already deleted.");
+        return;
+    }
+
+    connect( m_socket, SIGNAL(readyRead()),
+             this, SLOT(onReadyRead()), Qt::UniqueConnection );
+    onReadyRead();
+}
+
+void ClientSocket::abortOnReadError()
+{
+    log( tr("Failed to read message from client!"), LogError );
+    m_socket->abort();
+    onStateChanged(QLocalSocket::UnconnectedState);
 }
@@ -20,17 +20,26 @@
 #ifndef CLIENTSOCKET_H
 #define CLIENTSOCKET_H
 
+#include <QByteArray>
+#include <QList>
 #include <QLocalSocket>
+#include <QMutex>
 #include <QObject>
 #include <QPointer>
-
-class Arguments;
+#include <QWaitCondition>
 
 class ClientSocket : public QObject
 {
     Q_OBJECT
     friend class Server;
 public:
+    /// Result of waitForPendingBytes().
+    enum WaitResult {
+        WaitSucceeded,
+        WaitTimedOut,
+        WaitSocketClosed
+    };
+
     ClientSocket();
 
     explicit ClientSocket(QLocalSocket *socket, QObject *parent = NULL);
@@ -40,6 +49,23 @@ public:
     /// Start emiting messageReceived(). This method is thread-safe.
     void start();
 
+    /**
+     * Create channel for a command in multiplexed session.
+     *
+     * Messages sent through the channel are prefixed with @a channelId and sent
+     * using this socket. Channel is closed after final message is sent
+     * or when this socket is closed.
+     */
+    ClientSocket *createChannel(qint32 channelId);
+
+    /**
+     * Block until at most @a maxBytes of sent messages wait to be written to the socket,
+     * the socket is closed or @a timeoutMs milliseconds elapsed.
+     *
+     * This method is thread-safe but it must not be called from thread of the socket.
+     */
+    WaitResult waitForPendingBytes(qint64 maxBytes, int timeoutMs);
+
 public slots:
     /** Send message to client. */
     void sendMessage(
@@ -57,15 +83,52 @@ signals:
     void disconnected();
 
 private slots:
+    void onStart();
     void onReadyRead();
+    void onBytesWritten();
     void onError(QLocalSocket::LocalSocketError error);
     void onStateChanged(QLocalSocket::LocalSocketState state);
 
 private:
-    /// Receive arguments from client.
-    Arguments readArguments();
+    ClientSocket(ClientSocket *parentSocket, qint32 channelId);
+
+    /**
+     * Emit messageReceived() only for first message from client (with arguments)
+     * before start() is called.
+     */
+    void receiveArguments();
+
+    void startReading();
+
+    void abortOnReadError();
+
+    void sendChannelMessage(const QByteArray &message, int messageCode);
+
+    /// Queue message (prefixed with @a prefix) and write as much as socket buffer allows.
+    void writeMessage(const QByteArray &message, int messageCode, const QByteArray &prefix);
+
+    /// Write queued data; unless @a writeAll is true, stop if socket buffer is full.
+    void writePendingData(bool writeAll);
+
+    void updatePendingBytes();
 
     QPointer<QLocalSocket> m_socket;
+    QPointer<ClientSocket> m_parentSocket;
+    qint32 m_channelId;
+    bool m_isChannel;
+    QList<QByteArray> m_pendingData;
+    int m_pendingDataOffset;
+    qint64 m_queuedBytes;
+    QMutex m_pendingBytesMutex;
+    QWaitCondition m_pendingBytesChanged;
+    qint64 m_pendingBytes;
+    bool m_pendingBytesClosed; ///< Closed state for other threads (guarded by m_pendingBytesMutex).
+    QByteArray m_message;
+    qint64 m_messageBytesRead;
+    qint32 m_messageCode;
+    bool m_hasMessageHeader;
+    bool m_started;
+    bool m_receivingArguments;
     bool m_deleteAfterDisconnected;
     bool m_closed;
 };
@@ -28,7 +28,7 @@ enum CommandStatus {
     CommandError = 1,
     /** Bad command syntax. */
     CommandBadSyntax = 2,
-    /** Command successfully invoked. */
+    /** Command successfully invoked (message contains part of output). */
     CommandSuccess,
     /** Activate window */
     CommandActivateWindow,
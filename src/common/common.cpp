@@ -149,18 +149,24 @@ const QMimeData *clipboardData(QClipboard::Mode mode)
     return data;
 }
 
+bool isClipboardMetadataFormat(const QString &mime)
+{
+    return mime == mimeWindowTitle
+            || mime == mimeOwner
+#ifdef COPYQ_WS_X11
+            || mime == mimeClipboardMode
+#endif
+            ;
+}
+
 uint hash(const QVariantMap &data)
 {
     uint hash = 0;
 
     foreach ( const QString &mime, data.keys() ) {
         // Skip some special data.
-        if (mime == mimeWindowTitle || mime == mimeOwner)
-            continue;
-#ifdef COPYQ_WS_X11
-        if (mime == mimeClipboardMode)
+        if ( isClipboardMetadataFormat(mime) )
             continue;
-#endif
         hash ^= qHash(data[mime].toByteArray()) + qHash(mime);
     }
 
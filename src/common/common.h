@@ -58,6 +58,14 @@ bool isMainThread();
 
 const QMimeData *clipboardData(QClipboard::Mode mode = QClipboard::Clipboard);
 
+/**
+ * Return true if @a mime format only describes where the data come from
+ * (e.g. window title) and it's not part of the data itself.
+ *
+ * Such formats are ignored in hash().
+ */
+bool isClipboardMetadataFormat(const QString &mime);
+
 uint hash(const QVariantMap &data);
 
 QByteArray getUtf8Data(const QMimeData &data, const QString &format);
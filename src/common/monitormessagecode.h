@@ -30,7 +30,18 @@ enum MonitorMessageCode {
     MonitorChangeClipboardAndSelection,
     MonitorClipboardChanged,
     MonitorIgnoreClipboard,
-    MonitorLog
+    MonitorLog,
+    /** Clipboard data were passed in shared memory (message contains key and size). */
+    MonitorClipboardChangedShared,
+    /** Shared memory with clipboard data can be released (message contains key). */
+    MonitorReleaseSharedData,
+    /**
+     * Clipboard changed but only hash, format sizes and metadata are sent
+     * (message contains id, hash, format sizes and metadata).
+     */
+    MonitorClipboardChangedHash,
+    /** Server replies whether it needs whole clipboard data (message contains id and bool). */
+    MonitorClipboardDataNeeded
 };
 
 #endif // MONITORMESSAGECODE_H
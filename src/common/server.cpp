@@ -28,6 +28,7 @@
 #include <QDataStream>
 #include <QLocalServer>
 #include <QLocalSocket>
+#include <QTimer>
 
 #ifdef Q_OS_WIN
 #   include <qt_windows.h>
@@ -35,6 +36,11 @@
 
 namespace {
 
+// Close connection if client doesn't send arguments in time (in ms).
+const int argumentsTimeoutMs = 4000;
+
+const char argumentsTimerName[] = "CopyQ_arguments_timer";
+
 #ifdef Q_OS_WIN
 class SystemWideMutex {
 public:
@@ -112,6 +118,7 @@ Server::Server(const QString &name, QObject *parent)
     : QObject(parent)
     , m_server(newServer(name, this))
     , m_socketCount(0)
+    , m_socketsWaitingForArguments()
 {
     COPYQ_LOG( QString(isListening()
                        ? "Server \"%1\" started."
@@ -144,32 +151,77 @@ void Server::onNewConnection()
         log("Client is not connected!", LogError);
         socket->deleteLater();
     } else {
-        QScopedPointer<ClientSocket> clientSocket( new ClientSocket(socket) );
-
-        const Arguments args = clientSocket->readArguments();
-        if ( !args.isEmpty() ) {
-            ++m_socketCount;
-            connect( clientSocket.data(), SIGNAL(destroyed()),
-                     this, SLOT(onSocketClosed()) );
-            connect( this, SIGNAL(destroyed()),
-                     clientSocket.data(), SLOT(close()) );
-            connect( this, SIGNAL(destroyed()),
-                     clientSocket.data(), SLOT(deleteAfterDisconnected()) );
-            emit newConnection( args, clientSocket.take() );
-        }
+        ClientSocket *clientSocket = new ClientSocket(socket);
+
+        ++m_socketCount;
+        connect( clientSocket, SIGNAL(destroyed()),
+                 this, SLOT(onSocketClosed()) );
+        connect( this, SIGNAL(destroyed()),
+                 clientSocket, SLOT(close()) );
+        connect( this, SIGNAL(destroyed()),
+                 clientSocket, SLOT(deleteAfterDisconnected()) );
+
+        // Don't block while waiting for arguments from client.
+        connect( clientSocket, SIGNAL(messageReceived(QByteArray,int)),
+                 this, SLOT(onArgumentsReceived(QByteArray,int)) );
+        connect( clientSocket, SIGNAL(disconnected()),
+                 clientSocket, SLOT(deleteLater()) );
+
+        QTimer *timer = new QTimer(clientSocket);
+        timer->setObjectName(argumentsTimerName);
+        timer->setSingleShot(true);
+        timer->setInterval(argumentsTimeoutMs);
+        connect( timer, SIGNAL(timeout()),
+                 clientSocket, SLOT(close()) );
+        timer->start();
+
+        m_socketsWaitingForArguments.insert(clientSocket);
+        clientSocket->receiveArguments();
+    }
+}
+
+void Server::onArgumentsReceived(const QByteArray &message, int messageCode)
+{
+    ClientSocket *clientSocket = qobject_cast<ClientSocket*>(sender());
+    Q_ASSERT(clientSocket);
+
+    disconnect( clientSocket, SIGNAL(messageReceived(QByteArray,int)),
+                this, SLOT(onArgumentsReceived(QByteArray,int)) );
+    disconnect( clientSocket, SIGNAL(disconnected()),
+                clientSocket, SLOT(deleteLater()) );
+
+    delete clientSocket->findChild<QTimer*>(argumentsTimerName);
+    m_socketsWaitingForArguments.remove(clientSocket);
+
+    QDataStream input(message);
+    Arguments args;
+    input >> args;
+    if ( messageCode != 0 || input.status() != QDataStream::Ok || args.isEmpty() ) {
+        log( tr("Failed to read message from client!"), LogError );
+        clientSocket->close();
+        clientSocket->deleteAfterDisconnected();
+        return;
     }
+
+    COPYQ_LOG_VERBOSE("Arguments received from client.");
+    emit newConnection(args, clientSocket);
 }
 
 void Server::onSocketClosed()
 {
     Q_ASSERT(m_socketCount > 0);
     --m_socketCount;
+    m_socketsWaitingForArguments.remove( static_cast<ClientSocket*>(sender()) );
 }
 
 void Server::close()
 {
     m_server->close();
 
+    // Nobody would handle these connections.
+    foreach (ClientSocket *clientSocket, m_socketsWaitingForArguments)
+        clientSocket->close();
+
     COPYQ_LOG( QString("Sockets open: %1").arg(m_socketCount) );
     while (m_socketCount > 0)
         QCoreApplication::processEvents();
@@ -21,6 +21,7 @@
 #define SERVER_H
 
 #include <QObject>
+#include <QSet>
 
 class Arguments;
 class ClientSocket;
@@ -41,12 +42,14 @@ signals:
 
 private slots:
     void onNewConnection();
+    void onArgumentsReceived(const QByteArray &message, int messageCode);
     void onSocketClosed();
     void close();
 
 private:
     QLocalServer *m_server;
     int m_socketCount;
+    QSet<ClientSocket*> m_socketsWaitingForArguments;
 };
 
 #endif // SERVER_H
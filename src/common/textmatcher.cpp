@@ -0,0 +1,290 @@
+/*
+    Copyright (c) 2014, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "textmatcher.h"
+
+#include <QStringRef>
+
+#ifdef COPYQ_TEXTMATCHER_PCRE
+#   include <QHash>
+#   include <QMutex>
+#   include <QMutexLocker>
+#   include <QPair>
+#endif
+
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   define COPYQ_TEXTMATCHER_SSE2
+#   include <emmintrin.h>
+#endif
+
+namespace {
+
+bool isRegExpSpecialCharacter(QChar c)
+{
+    static const QString chars("$()*+.?[\\]^{|}");
+    return chars.contains(c);
+}
+
+/**
+ * Return unescaped string if @a re matches only a plain string, otherwise null string.
+ */
+QString literalPattern(const QRegExp &re)
+{
+    const QString pattern = re.pattern();
+
+    switch ( re.patternSyntax() ) {
+    case QRegExp::FixedString:
+        return pattern;
+
+    case QRegExp::Wildcard:
+    case QRegExp::WildcardUnix:
+        if ( pattern.contains(QRegExp("[*?[\\\\]")) )
+            return QString();
+        return pattern;
+
+    case QRegExp::RegExp:
+    case QRegExp::RegExp2:
+        break;
+
+    default:
+        return QString();
+    }
+
+    QString text;
+    text.reserve( pattern.size() );
+
+    for (int i = 0; i < pattern.size(); ++i) {
+        QChar c = pattern[i];
+        if (c == '\\') {
+            if (++i == pattern.size())
+                return QString();
+            c = pattern[i];
+            // Escape sequences like \d, \n or \x20 are not plain characters.
+            if ( c.isLetterOrNumber() )
+                return QString();
+        } else if ( isRegExpSpecialCharacter(c) ) {
+            return QString();
+        }
+
+        text.append(c);
+    }
+
+    return text;
+}
+
+/**
+ * Substring search which quickly skips characters that cannot start a match
+ * (using SSE2 to test multiple characters at once if available)
+ * and then verifies the candidate positions.
+ */
+class LiteralFinder
+{
+public:
+    LiteralFinder(const QString &text, const QString &needle, Qt::CaseSensitivity cs)
+        : m_text(text)
+        , m_needle(needle)
+        , m_cs(cs)
+        , m_first(needle[0].unicode())
+        , m_firstOtherCase(m_first)
+    {
+        if (cs == Qt::CaseInsensitive) {
+            const QChar lower = needle[0].toLower();
+            m_first = lower.unicode();
+            m_firstOtherCase = lower.toUpper().unicode();
+        }
+    }
+
+    int find(int from) const
+    {
+        const int last = m_text.size() - m_needle.size();
+        const ushort *data = m_text.utf16();
+        int i = qMax(0, from);
+
+#ifdef COPYQ_TEXTMATCHER_SSE2
+        const __m128i first = _mm_set1_epi16( static_cast<short>(m_first) );
+        const __m128i firstOtherCase = _mm_set1_epi16( static_cast<short>(m_firstOtherCase) );
+        const __m128i nonAsciiMask = _mm_set1_epi16( static_cast<short>(0xff80) );
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i ones = _mm_cmpeq_epi16(zero, zero);
+
+        for ( ; i + 8 <= last + 1; i += 8 ) {
+            const __m128i block = _mm_loadu_si128( reinterpret_cast<const __m128i*>(data + i) );
+            __m128i candidates = _mm_or_si128(
+                        _mm_cmpeq_epi16(block, first), _mm_cmpeq_epi16(block, firstOtherCase) );
+
+            // Any non-ASCII character can be equal to the first character if case is ignored.
+            if (m_cs == Qt::CaseInsensitive) {
+                const __m128i ascii = _mm_cmpeq_epi16( _mm_and_si128(block, nonAsciiMask), zero );
+                candidates = _mm_or_si128( candidates, _mm_xor_si128(ascii, ones) );
+            }
+
+            const int bits = _mm_movemask_epi8(candidates);
+            if (bits == 0)
+                continue;
+
+            for (int j = 0; j < 8; ++j) {
+                if ( (bits & (1 << (2 * j))) != 0 && matchesAt(i + j) )
+                    return i + j;
+            }
+        }
+#endif
+
+        for ( ; i <= last; ++i ) {
+            if ( isCandidate(data[i]) && matchesAt(i) )
+                return i;
+        }
+
+        return -1;
+    }
+
+private:
+    bool isCandidate(ushort c) const
+    {
+        return c == m_first || c == m_firstOtherCase
+                || (m_cs == Qt::CaseInsensitive && c >= 0x80);
+    }
+
+    bool matchesAt(int i) const
+    {
+        if (m_cs == Qt::CaseSensitive) {
+            return std::memcmp( m_text.utf16() + i, m_needle.utf16(),
+                                m_needle.size() * sizeof(ushort) ) == 0;
+        }
+
+        return QStringRef(&m_text, i, m_needle.size()).compare(m_needle, m_cs) == 0;
+    }
+
+    const QString &m_text;
+    const QString &m_needle;
+    Qt::CaseSensitivity m_cs;
+    ushort m_first;
+    ushort m_firstOtherCase;
+};
+
+#ifdef COPYQ_TEXTMATCHER_PCRE
+/// Maximum number of compiled expressions to keep in cache.
+const int regularExpressionCacheSize = 256;
+
+QRegularExpression::PatternOptions patternOptions(const QRegExp &re)
+{
+    QRegularExpression::PatternOptions options = QRegularExpression::NoPatternOption;
+    if (re.caseSensitivity() == Qt::CaseInsensitive)
+        options |= QRegularExpression::CaseInsensitiveOption;
+    if ( re.isMinimal() )
+        options |= QRegularExpression::InvertedGreedinessOption;
+    return options;
+}
+
+/**
+ * Return compiled and optimized expression or invalid expression if
+ * @a re cannot be converted (QRegExp is used in such case).
+ */
+QRegularExpression compiledRegularExpression(const QRegExp &re)
+{
+    if ( re.patternSyntax() != QRegExp::RegExp && re.patternSyntax() != QRegExp::RegExp2 )
+        return QRegularExpression();
+
+    typedef QPair<QString, int> CacheKey;
+    static QHash<CacheKey, QRegularExpression> cache;
+    static QMutex mutex;
+
+    const QRegularExpression::PatternOptions options = patternOptions(re);
+    const CacheKey key( re.pattern(), static_cast<int>(options) );
+
+    QMutexLocker lock(&mutex);
+
+    QHash<CacheKey, QRegularExpression>::const_iterator it = cache.constFind(key);
+    if ( it != cache.constEnd() )
+        return it.value();
+
+    QRegularExpression regex(re.pattern(), options);
+    if ( regex.isValid() )
+        regex.optimize();
+    else
+        regex = QRegularExpression();
+
+    if ( cache.size() >= regularExpressionCacheSize )
+        cache.clear();
+    cache.insert(key, regex);
+
+    return regex;
+}
+#endif
+
+} // namespace
+
+TextMatcher::TextMatcher()
+    : m_re()
+    , m_text()
+    , m_cs(Qt::CaseSensitive)
+    , m_literal(false)
+#ifdef COPYQ_TEXTMATCHER_PCRE
+    , m_regex()
+#endif
+{
+}
+
+TextMatcher::TextMatcher(const QRegExp &re)
+    : m_re(re)
+    , m_text( literalPattern(re) )
+    , m_cs( re.caseSensitivity() )
+    // Fast search finds candidates by first character. If case is ignored,
+    // non-ASCII first character can match ASCII (e.g. U+017F matches 's').
+    , m_literal( !m_text.isEmpty()
+                 && (m_cs == Qt::CaseSensitive || m_text[0].unicode() < 0x80) )
+#ifdef COPYQ_TEXTMATCHER_PCRE
+    , m_regex( m_literal || re.isEmpty() ? QRegularExpression() : compiledRegularExpression(re) )
+#endif
+{
+}
+
+int TextMatcher::indexIn(const QString &text, int from, int *length) const
+{
+    // Empty expression matches everything.
+    if ( m_re.isEmpty() ) {
+        if (length != NULL)
+            *length = 0;
+        return from <= text.size() ? qMax(0, from) : -1;
+    }
+
+    if (m_literal) {
+        const int i = LiteralFinder(text, m_text, m_cs).find(from);
+        if (length != NULL)
+            *length = i == -1 ? 0 : m_text.size();
+        return i;
+    }
+
+#ifdef COPYQ_TEXTMATCHER_PCRE
+    if ( m_regex.isValid() ) {
+        const QRegularExpressionMatch match = m_regex.match(text, from);
+        if (length != NULL)
+            *length = match.capturedLength();
+        return match.hasMatch() ? match.capturedStart() : -1;
+    }
+#endif
+
+    // QRegExp stores matching state so it's not possible to use single instance in more threads.
+    QRegExp re(m_re);
+    const int i = re.indexIn(text, from);
+    if (length != NULL)
+        *length = re.matchedLength();
+    return i;
+}
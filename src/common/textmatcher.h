@@ -0,0 +1,79 @@
+/*
+    Copyright (c) 2014, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TEXTMATCHER_H
+#define TEXTMATCHER_H
+
+#include <QRegExp>
+#include <QString>
+
+#if QT_VERSION >= 0x050400
+#   include <QRegularExpression>
+#   define COPYQ_TEXTMATCHER_PCRE
+#endif
+
+/**
+ * Matches text with regular expression.
+ *
+ * If the expression is just a plain string (which is the usual case when searching items)
+ * fast substring search is used instead of the regular expression.
+ * Search for multiple words (joined with ".*" by filter) is not a plain string
+ * and uses the regular expression.
+ *
+ * With Qt 5 the expression is compiled (using JIT if available) with QRegularExpression.
+ * Compiled expressions are cached and shared so creating matcher for same expression
+ * repeatedly is cheap. Matching is thread-safe (const methods can be called from
+ * multiple threads with single instance).
+ */
+class TextMatcher
+{
+public:
+    TextMatcher();
+
+    explicit TextMatcher(const QRegExp &re);
+
+    /** Return true if there is nothing to match. */
+    bool isEmpty() const { return m_re.isEmpty(); }
+
+    /** Return true if fast search for plain string is used. */
+    bool isLiteral() const { return m_literal; }
+
+    /** Return regular expression. */
+    const QRegExp &regExp() const { return m_re; }
+
+    /** Return true if @a text contains a match. */
+    bool matches(const QString &text) const { return indexIn(text) != -1; }
+
+    /**
+     * Return position of first match in @a text starting at @a from, -1 if not found.
+     * If @a length is not NULL, it's set to length of the match.
+     */
+    int indexIn(const QString &text, int from = 0, int *length = NULL) const;
+
+private:
+    QRegExp m_re;
+    QString m_text;
+    Qt::CaseSensitivity m_cs;
+    bool m_literal;
+#ifdef COPYQ_TEXTMATCHER_PCRE
+    QRegularExpression m_regex;
+#endif
+};
+
+#endif // TEXTMATCHER_H
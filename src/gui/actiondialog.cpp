@@ -199,7 +199,12 @@ void ActionDialog::setCommand(const Command &cmd)
 
     ui->comboBoxOutputFormat->setEditText(cmd.output);
 
-    m_capturedTexts = cmd.re.isEmpty() ? QStringList() : cmd.re.capturedTexts();
+    m_capturedTexts.clear();
+    if ( !cmd.re.isEmpty() ) {
+        QRegExp re(cmd.re);
+        if ( re.indexIn(getTextData(m_data)) != -1 )
+            m_capturedTexts = re.capturedTexts();
+    }
     m_actionName = cmd.name;
     m_actionName.remove('&');
 }
@@ -23,6 +23,7 @@
 #include "common/common.h"
 #include "common/contenttype.h"
 #include "common/mimetypes.h"
+#include "common/textmatcher.h"
 #include "gui/clipboarddialog.h"
 #include "gui/configtabappearance.h"
 #include "gui/configurationmanager.h"
@@ -153,6 +154,7 @@ ClipboardBrowserShared::ClipboardBrowserShared()
     , saveOnReturnKey(false)
     , moveItemOnReturnKey(false)
     , minutesToExpire(0)
+    , itemWidgetCacheSize(100)
 {
 }
 
@@ -166,6 +168,7 @@ void ClipboardBrowserShared::loadFromConfiguration()
     saveOnReturnKey = !cm->value("edit_ctrl_return").toBool();
     moveItemOnReturnKey = cm->value("move").toBool();
     minutesToExpire = cm->value("expire_tab").toInt();
+    itemWidgetCacheSize = cm->value("item_widget_cache_size").toInt();
 }
 
 ClipboardBrowser::ClipboardBrowser(QWidget *parent, const ClipboardBrowserSharedPtr &sharedData)
@@ -230,13 +233,37 @@ void ClipboardBrowser::closeExternalEditor(QObject *editor)
     editor->deleteLater();
 }
 
-bool ClipboardBrowser::isFiltered(int row) const
+bool ClipboardBrowser::matchesSearch(const TextMatcher &matcher, int row)
+{
+    // Texts are cached in model until item or enabled plugins change.
+    const ItemFactory *factory = ConfigurationManager::instance()->itemFactory();
+    const int version = factory->searchableTextsVersion();
+    QStringList texts;
+    if ( !m.searchableTexts(row, version, &texts) ) {
+        texts = factory->searchableTexts( m.index(row) );
+        m.setSearchableTexts(row, texts, version);
+    }
+
+    foreach (const QString &text, texts) {
+        if ( matcher.matches(text) )
+            return true;
+    }
+
+    return false;
+}
+
+bool ClipboardBrowser::isFiltered(int row)
 {
     if ( d.searchExpression().isEmpty() || !m_itemLoader)
         return false;
 
-    const QModelIndex ind = m.index(row);
-    return !ConfigurationManager::instance()->itemFactory()->matches( ind, d.searchExpression() );
+    return !matchesSearch( d.searchMatcher(), row );
+}
+
+void ClipboardBrowser::hideRow(int row, bool hide)
+{
+    setRowHidden(row, hide);
+    d.setRowHidden(row, hide);
 }
 
 bool ClipboardBrowser::hideFiltered(int row)
@@ -244,7 +271,7 @@ bool ClipboardBrowser::hideFiltered(int row)
     d.setRowVisible(row, false); // show in preload()
 
     bool hide = isFiltered(row);
-    setRowHidden(row, hide);
+    hideRow(row, hide);
 
     return hide;
 }
@@ -281,30 +308,16 @@ void ClipboardBrowser::preload(int minY, int maxY)
 {
     ClipboardBrowser::Lock lock(this);
 
-    QModelIndex ind;
-    int i = 0;
-    int y = spacing();
+    int y;
     const int s = 2 * spacing();
     int offset = verticalOffset();
 
     // Find first index to preload.
-    forever {
-        ind = index(i);
-        if ( !ind.isValid() )
-            return;
-
-        if ( !isIndexHidden(ind) ) {
-            const int h = d.sizeHint(ind).height();
-            y += h; // bottom of item
-            if (y >= offset)
-                break;
-            y += s; // top of next item
-        }
-
-        d.setRowVisible(i, false);
+    int i = d.rowAtOffset(offset, spacing(), &y);
+    if (i == -1)
+        return;
 
-        ++i;
-    }
+    QModelIndex ind = index(i);
 
     // Absolute to relative.
     y -= offset;
@@ -344,6 +357,8 @@ void ClipboardBrowser::preload(int minY, int maxY)
 
     y = visualRect(ind).y();
     bool lastToPreload = false;
+    const int firstVisibleRow = i;
+    int lastVisibleRow = i - 1;
 
     // Render visible items, re-layout rows and correct scroll offset.
     forever {
@@ -364,6 +379,7 @@ void ClipboardBrowser::preload(int minY, int maxY)
         d.updateRowPosition(i, y);
 
         d.setRowVisible(i, true);
+        lastVisibleRow = i;
 
         // Next.
         ind = index(++i);
@@ -384,8 +400,9 @@ void ClipboardBrowser::preload(int minY, int maxY)
     }
 
     // Hide the rest.
-    for ( ; i < m.rowCount(); ++i )
-        d.setRowVisible(i, false);
+    d.hideRowsOutside(firstVisibleRow, lastVisibleRow);
+
+    d.releaseUnusedWidgets();
 
     if (update)
         scheduleDelayedItemsLayout();
@@ -542,6 +559,8 @@ void ClipboardBrowser::connectModelAndDelegate()
              SLOT(onTabNameChanged(QString)) );
     connect( &m, SIGNAL(unloaded()),
              SLOT(onModelUnloaded()) );
+    connect( &m, SIGNAL(rowsAboutToBeRemoved(QModelIndex,int,int)),
+             SLOT(onRowsAboutToBeRemoved(QModelIndex,int,int)) );
 
     // update on change
     connect( &m, SIGNAL(rowsInserted(QModelIndex, int, int)),
@@ -617,7 +636,7 @@ void ClipboardBrowser::refilterItems()
     // Hide the rest until found.
     for ( int row = 0; row < length(); ++row ) {
         d.setRowVisible(row, showAll);
-        setRowHidden(row, !showAll);
+        hideRow(row, !showAll);
     }
 
     m_lastFiltered = -1;
@@ -628,7 +647,7 @@ void ClipboardBrowser::refilterItems()
     int selectedRow = d.searchExpression().pattern().toInt(&rowSpecified);
     if (rowSpecified && selectedRow >= 0 && selectedRow < length()) {
         d.setRowVisible(selectedRow, false); // Show in preload().
-        setRowHidden(selectedRow, false);
+        hideRow(selectedRow, false);
         setCurrentIndex( index(selectedRow) );
     }
 
@@ -899,6 +918,19 @@ void ClipboardBrowser::onModelUnloaded()
     m_itemLoader.clear();
 }
 
+void ClipboardBrowser::onRowsAboutToBeRemoved(const QModelIndex &, int first, int last)
+{
+    // Items are only unloaded from memory.
+    if (!m_itemLoader)
+        return;
+
+    QList<QModelIndex> indexList;
+    for (int row = first; row <= last; ++row)
+        indexList.append( index(row) );
+
+    ConfigurationManager::instance()->itemFactory()->itemsAboutToBeDeleted(indexList);
+}
+
 void ClipboardBrowser::onEditorNeedsChangeClipboard()
 {
     QModelIndex index = m_editor->index();
@@ -1289,6 +1321,23 @@ void ClipboardBrowser::filterItems(const QRegExp &re)
     refilterItems();
 }
 
+QList<int> ClipboardBrowser::findItems(const QRegExp &re, int from, int limit, int *next)
+{
+    const TextMatcher matcher(re);
+    QList<int> rows;
+
+    int row = qMax(0, from);
+    for ( ; row < length() && (limit <= 0 || rows.size() < limit); ++row ) {
+        if ( matcher.isEmpty() || matchesSearch(matcher, row) )
+            rows.append(row);
+    }
+
+    if (next != NULL)
+        *next = row < length() ? row : -1;
+
+    return rows;
+}
+
 void ClipboardBrowser::moveToClipboard(const QModelIndex &ind)
 {
     if ( !ind.isValid() )
@@ -1572,7 +1621,7 @@ bool ClipboardBrowser::add(const QVariantMap &data, int row)
 
     // filter item
     if ( isFiltered(newRow) ) {
-        setRowHidden(newRow, true);
+        hideRow(newRow, true);
     } else if (!keepUserSelection) {
         // Select new item if clipboard is not focused and the item is not filtered-out.
         clearSelection();
@@ -1602,6 +1651,7 @@ void ClipboardBrowser::loadSettings()
     updateItemMaximumSize();
 
     d.setSaveOnEnterKey(m_sharedData->saveOnReturnKey);
+    d.setMaximumCachedWidgets(m_sharedData->itemWidgetCacheSize);
 
     updateCurrentPage();
 
@@ -1698,6 +1748,10 @@ void ClipboardBrowser::purgeItems()
 {
     if ( tabName().isEmpty() )
         return;
+
+    if ( m_itemLoader && m.rowCount() > 0 )
+        onRowsAboutToBeRemoved( QModelIndex(), 0, m.rowCount() - 1 );
+
     ConfigurationManager::instance()->removeItems(tabName());
     m_timerSave.stop();
 }
@@ -57,6 +57,7 @@ struct ClipboardBrowserShared {
     bool saveOnReturnKey;
     bool moveItemOnReturnKey;
     int minutesToExpire;
+    int itemWidgetCacheSize;
 };
 typedef QSharedPointer<ClipboardBrowserShared> ClipboardBrowserSharedPtr;
 
@@ -185,6 +186,14 @@ class ClipboardBrowser : public QListView
         void moveToClipboard(const QModelIndex &ind);
         /** Show only items matching the regular expression. */
         void filterItems(const QRegExp &re);
+        /**
+         * Return rows of items matching the regular expression starting at row @a from.
+         *
+         * If @a limit is positive, at most @a limit rows are returned.
+         * If @a next is not NULL, it's set to row where next search should start
+         * or -1 if all remaining items were searched.
+         */
+        QList<int> findItems(const QRegExp &re, int from = 0, int limit = 0, int *next = NULL);
         /** Show all items. */
         void clearFilter() { filterItems( QRegExp() ); }
         /** Open editor. */
@@ -314,6 +323,8 @@ class ClipboardBrowser : public QListView
     private slots:
         void onModelDataChanged();
 
+        void onRowsAboutToBeRemoved(const QModelIndex &parent, int first, int last);
+
         void onDataChanged(const QModelIndex &a, const QModelIndex &b);
 
         void onItemCountChanged();
@@ -348,7 +359,13 @@ class ClipboardBrowser : public QListView
          */
         void delayedSaveItems();
 
-        bool isFiltered(int row) const;
+        /** Return true if @a matcher matches any searchable text of item in @a row. */
+        bool matchesSearch(const TextMatcher &matcher, int row);
+
+        bool isFiltered(int row);
+
+        /** Hide or show row in view (keeps row height index in delegate up to date). */
+        void hideRow(int row, bool hide);
 
         /**
          * Hide row if filtered out, otherwise show.
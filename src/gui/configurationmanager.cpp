@@ -455,6 +455,7 @@ void ConfigurationManager::initOptions()
 
     /* other options */
     bind("command_history_size", 100);
+    bind("item_widget_cache_size", 100);
 #ifdef COPYQ_WS_X11
     /* X11 clipboard selection monitoring and synchronization */
     bind("check_selection", ui->checkBoxSel, false);
@@ -500,6 +501,7 @@ void ConfigurationManager::bind(const char *optionKey, const QVariant &defaultVa
 
 void ConfigurationManager::updateIcons()
 {
+    iconFactory()->invalidateCache();
     iconFactory()->setUseSystemIcons(
                 tabAppearance()->themeValue("use_system_icons").toBool() );
 }
@@ -84,6 +84,7 @@ QRegExp FilterLineEdit::filter() const
     if (m_actionRe->isChecked()) {
         pattern = text();
     } else {
+        // Note: Only single word can be matched with fast plain string search (see TextMatcher).
         foreach ( const QString &str, text().split(QRegExp("\\s+"), QString::SkipEmptyParts) ) {
             if ( !pattern.isEmpty() )
                 pattern.append(".*");
@@ -29,6 +29,7 @@
 #include <QIcon>
 #include <QPainter>
 #include <QPixmap>
+#include <QPixmapCache>
 #include <QVariant>
 #include <QWidget>
 
@@ -152,13 +153,48 @@ public:
     }
 
     QPixmap createPixmap(const QSize &size, QIcon::Mode mode, QIcon::State state, QPainter *painter = NULL)
+    {
+        const QColor iconColor = color(painter, mode);
+        const QString key = m_factory->pixmapCacheKey(
+                    QString("icon_%1_%2x%3_%4_%5_%6_%7")
+                    .arg(m_iconId)
+                    .arg(size.width())
+                    .arg(size.height())
+                    .arg(iconColor.rgba())
+                    .arg(static_cast<int>(mode))
+                    .arg(static_cast<int>(state))
+                    .arg(m_iconName) );
+
+        QPixmap pixmap;
+        if ( !QPixmapCache::find(key, &pixmap) ) {
+            pixmap = createPixmapHelper(size, mode, state, iconColor);
+            QPixmapCache::insert(key, pixmap);
+        }
+
+        return pixmap;
+    }
+
+    static QIcon createIcon(ushort iconId, const QString &iconName, IconFactory *factory)
+    {
+        return QIcon( new IconEngine(iconId, iconName, factory) );
+    }
+
+private:
+    IconEngine(ushort iconId, const QString &iconName, IconFactory *factory)
+        : m_iconId(iconId)
+        , m_iconName(iconName)
+        , m_factory(factory)
+    {
+    }
+
+    QPixmap createPixmapHelper(const QSize &size, QIcon::Mode mode, QIcon::State state, const QColor &color)
     {
         if ( m_iconId == 0 || m_factory->useSystemIcons() ) {
             // Tint tab icons.
             if ( m_iconName.startsWith(imagesRecourcePath + QString("tab_")) ) {
                 QPixmap pixmap(m_iconName);
                 pixmap = pixmap.scaled(size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
-                return colorizedPixmap( pixmap, color(painter, mode) );
+                return colorizedPixmap(pixmap, color);
             }
 
             QIcon icon = m_iconName.startsWith(':') ? QIcon(m_iconName) : QIcon::fromTheme(m_iconName);
@@ -172,24 +208,11 @@ public:
         if (m_iconId == 0)
             return pixmap;
 
-        drawFontIcon( &pixmap, m_iconId, size.width(), size.height(), color(painter, mode) );
+        drawFontIcon( &pixmap, m_iconId, size.width(), size.height(), color );
 
         return pixmap;
     }
 
-    static QIcon createIcon(ushort iconId, const QString &iconName, IconFactory *factory)
-    {
-        return QIcon( new IconEngine(iconId, iconName, factory) );
-    }
-
-private:
-    IconEngine(ushort iconId, const QString &iconName, IconFactory *factory)
-        : m_iconId(iconId)
-        , m_iconName(iconName)
-        , m_factory(factory)
-    {
-    }
-
     QColor color(QPainter *painter, QIcon::Mode mode)
     {
         QWidget *parent = painter ? dynamic_cast<QWidget*>(painter->device())
@@ -214,10 +237,21 @@ private:
 IconFactory::IconFactory()
     : m_useSystemIcons(true)
     , m_iconFontLoaded(false)
+    , m_activePaintDevice()
+    , m_cacheGeneration(0)
 {
     m_iconFontLoaded = QFontDatabase::addApplicationFont(":/images/fontawesome-webfont.ttf") != -1;
 }
 
+void IconFactory::setUseSystemIcons(bool enable)
+{
+    if (m_useSystemIcons == enable)
+        return;
+
+    m_useSystemIcons = enable;
+    invalidateCache();
+}
+
 QIcon IconFactory::getIcon(const QString &themeName, ushort id)
 {
     return m_iconFontLoaded || !themeName.isEmpty()
@@ -244,22 +278,38 @@ QIcon IconFactory::iconFromFile(const QString &fileName)
 
 QPixmap IconFactory::createPixmap(ushort id, const QColor &color, int size)
 {
-    QPixmap pixmap(size, size);
+    const QString key = pixmapCacheKey(
+                QString("font_icon_%1_%2_%3").arg(id).arg(color.rgba()).arg(size) );
+
+    QPixmap pixmap;
+    if ( QPixmapCache::find(key, &pixmap) )
+        return pixmap;
+
+    pixmap = QPixmap(size, size);
     pixmap.fill(Qt::transparent);
 
     if (m_iconFontLoaded)
         drawFontIcon(&pixmap, id, size, size, color);
 
+    QPixmapCache::insert(key, pixmap);
+
     return pixmap;
 }
 
 QIcon IconFactory::appIcon(AppIconFlags flags)
 {
-    QPixmap pix = flags.testFlag(AppIconRunning)
+    const QString sessionName = qApp->property("CopyQ_session_name").toString();
+    const QString key = pixmapCacheKey(
+                QString("app_icon_%1_%2").arg(static_cast<int>(flags)).arg(sessionName) );
+
+    QPixmap pix;
+    if ( QPixmapCache::find(key, &pix) )
+        return QIcon(pix);
+
+    pix = flags.testFlag(AppIconRunning)
             ? imageFromPrefix("-busy.svg", "icon-running")
             : imageFromPrefix("-normal.svg", "icon");
 
-    const QString sessionName = qApp->property("CopyQ_session_name").toString();
     if (!sessionName.isEmpty()) {
         const QColor color1 = QColor(0x7f, 0xca, 0x9b);
         const QColor color2 = sessionNameToColor(sessionName);
@@ -272,9 +322,22 @@ QIcon IconFactory::appIcon(AppIconFlags flags)
         p.fillRect(pix.rect(), QColor(100, 100, 100, 100));
     }
 
+    QPixmapCache::insert(key, pix);
+
     return QIcon(pix);
 }
 
+void IconFactory::invalidateCache()
+{
+    // Old pixmaps are not found anymore and will be dropped from cache eventually.
+    ++m_cacheGeneration;
+}
+
+QString IconFactory::pixmapCacheKey(const QString &name) const
+{
+    return QString("CopyQ_%1_%2").arg(m_cacheGeneration).arg(name);
+}
+
 QColor getDefaultIconColor(const QWidget &widget, bool selected)
 {
     const QWidget *parent = &widget;
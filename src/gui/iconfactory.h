@@ -47,7 +47,7 @@ public:
     QIcon getIcon(const QString &themeName, ushort id);
     QIcon getIconFromResources(const QString &iconName);
 
-    void setUseSystemIcons(bool enable) { m_useSystemIcons = enable; }
+    void setUseSystemIcons(bool enable);
     bool useSystemIcons() const { return m_useSystemIcons || !m_iconFontLoaded; }
 
     QIcon iconFromFile(const QString &fileName);
@@ -57,6 +57,12 @@ public:
     /// Return app icon (color is calculated from session name).
     QIcon appIcon(AppIconFlags flags = AppIconNormal);
 
+    /// Drop cached pixmaps (e.g. if theme changes).
+    void invalidateCache();
+
+    /// Return key for cached pixmap (different after invalidateCache() is called).
+    QString pixmapCacheKey(const QString &name) const;
+
     QObject *activePaintDevice() const { return m_activePaintDevice; }
     void setActivePaintDevice(QObject *device) { m_activePaintDevice = device; }
 
@@ -64,6 +70,7 @@ private:
     bool m_useSystemIcons;
     bool m_iconFontLoaded;
     QPointer<QObject> m_activePaintDevice;
+    int m_cacheGeneration;
 };
 
 QColor getDefaultIconColor(const QWidget &widget, bool selected = false);
@@ -26,6 +26,7 @@
 #include "common/contenttype.h"
 #include "common/log.h"
 #include "common/mimetypes.h"
+#include "common/textmatcher.h"
 #include "gui/aboutdialog.h"
 #include "gui/actiondialog.h"
 #include "gui/actionhandler.h"
@@ -88,8 +89,11 @@ bool canPaste()
     return !QApplication::queryKeyboardModifiers().testFlag(Qt::ControlModifier);
 }
 
-bool canExecuteCommand(const Command &command, const QVariantMap &data, const QString &sourceTabName)
+bool canExecuteCommand(
+        const CompiledCommand &compiledCommand, const QVariantMap &data, const QString &sourceTabName)
 {
+    const Command &command = compiledCommand.command;
+
     // Verify that an action is provided.
     if ( command.cmd.isEmpty() && !command.remove
          && (command.tab.isEmpty() || command.tab == sourceTabName) )
@@ -116,12 +120,36 @@ bool canExecuteCommand(const Command &command, const QVariantMap &data, const QS
     // Verify that and text, MIME type and window title are matched.
     const QString text = getTextData(data);
     const QString windowTitle = data.value(mimeWindowTitle).toString();
-    if ( command.re.indexIn(text) == -1 || command.wndre.indexIn(windowTitle) == -1 )
+    if ( !compiledCommand.matcher.matches(text)
+         || !compiledCommand.windowMatcher.matches(windowTitle) )
         return false;
 
     return true;
 }
 
+/**
+ * Return key identifying clipboard data and tab for commands in tray menu.
+ *
+ * Includes metadata (e.g. window title) skipped by hash() since commands can match it.
+ */
+QString commandsKeyForData(const QVariantMap &data, const QString &tabName)
+{
+    QString key = QString::number( hash(data) ) + ";" + tabName;
+    foreach ( const QString &mime, data.keys() ) {
+        if ( isClipboardMetadataFormat(mime) )
+            key.append( ";" + mime + "=" + data[mime].toString() );
+    }
+    return key;
+}
+
+QList<CompiledCommand> compileCommands(const QList<Command> &commands)
+{
+    QList<CompiledCommand> compiledCommands;
+    foreach (const Command &command, commands)
+        compiledCommands.append( CompiledCommand(command) );
+    return compiledCommands;
+}
+
 bool hasFormat(const QVariantMap &data, const QString &format)
 {
     if (format == mimeItems) {
@@ -230,6 +258,7 @@ MainWindow::MainWindow(QWidget *parent)
     , ui(new Ui::MainWindow)
     , m_menuItem(NULL)
     , m_trayMenu( new TrayMenu(this) )
+    , m_trayMenuCommandsKey()
     , m_tray(NULL)
     , m_clipboardStoringDisabled(false)
     , m_actionToggleClipboardStoring()
@@ -287,7 +316,7 @@ MainWindow::MainWindow(QWidget *parent)
     connect(&m_automaticCommandTester, SIGNAL(commandPassed(Command,bool)),
             SLOT(automaticCommandTestFinished(Command,bool)));
 
-    m_commands = loadCommands();
+    m_commands = compileCommands( loadCommands() );
     loadSettings();
 
     ui->tabWidget->setCurrentIndex(0);
@@ -363,7 +392,7 @@ void MainWindow::createMenu()
     QAction *act;
 
     menubar->clear();
-    m_trayMenu->clear();
+    clearTrayMenu();
 
     // File
     menu = menubar->addMenu( tr("&File") );
@@ -558,7 +587,8 @@ void MainWindow::onAboutToQuit()
 
 void MainWindow::onCommandDialogSaved()
 {
-    m_commands = loadCommands();
+    m_commands = compileCommands( loadCommands() );
+    clearTrayMenu();
     updateContextMenu();
     emit commandsSaved();
 }
@@ -908,8 +938,11 @@ void MainWindow::addCommandsToMenu(QMenu *menu, const QVariantMap &data)
 
     QList<Command> disabledCommands;
     QList<Command> commands;
-    foreach (const Command &command, m_commands) {
-        if ( command.inMenu && !command.name.isEmpty() && canExecuteCommand(command, data, tabName) ) {
+    foreach (const CompiledCommand &compiledCommand, m_commands) {
+        const Command &command = compiledCommand.command;
+        if ( command.inMenu && !command.name.isEmpty()
+             && canExecuteCommand(compiledCommand, data, tabName) )
+        {
             Command cmd = command;
             if ( cmd.outputTab.isEmpty() )
                 cmd.outputTab = tabName;
@@ -1451,6 +1484,8 @@ void MainWindow::loadSettings()
     m_options.clipboardNotificationLines = cm->value("clipboard_notification_lines").toInt();
 
     m_trayMenu->setStyleSheet( cm->tabAppearance()->getToolTipStyleSheet() );
+    // Recreate tray menu actions since icons and labels may have changed.
+    clearTrayMenu();
 
     initTray();
 
@@ -1708,8 +1743,9 @@ void MainWindow::runAutomaticCommands(const QVariantMap &data)
 {
     QList<Command> commands;
     const QString &tabName = getBrowser(0)->tabName();
-    foreach (const Command &command, m_commands) {
-        if (command.automatic && canExecuteCommand(command, data, tabName)) {
+    foreach (const CompiledCommand &compiledCommand, m_commands) {
+        const Command &command = compiledCommand.command;
+        if (command.automatic && canExecuteCommand(compiledCommand, data, tabName)) {
             commands.append(command);
             if ( command.outputTab.isEmpty() )
                 commands.last().outputTab = tabName;
@@ -1771,6 +1807,22 @@ void MainWindow::clipboardChanged(const QVariantMap &data)
     }
 }
 
+QVariantMap MainWindow::firstTabItemData(uint itemHash)
+{
+    ClipboardBrowser *c = browser(0);
+
+    if ( !c->isLoaded() )
+        return QVariantMap();
+
+    for (int row = 0; row < c->length(); ++row) {
+        const QModelIndex index = c->index(row);
+        if ( index.data(contentType::hash).toUInt() == itemHash )
+            return itemData(index);
+    }
+
+    return QVariantMap();
+}
+
 void MainWindow::setClipboard(const QVariantMap &data, QClipboard::Mode mode)
 {
     emit changeClipboard(data, mode);
@@ -1952,44 +2004,54 @@ void MainWindow::updateTrayMenuItems()
 
     ClipboardBrowser *c = getTabForTrayMenu();
 
-    clearTrayMenu();
-
-    QAction *act = m_trayMenu->addAction(
-                appIcon(), tr("&Show/Hide"), this, SLOT(toggleVisible()) );
-    m_trayMenu->setDefaultAction(act);
-    addTrayAction(Actions::File_New);
-    act = addTrayAction(Actions::Item_Action);
-    act->setWhatsThis( tr("Open action dialog") );
-    addTrayAction(Actions::File_Preferences);
-    addTrayAction(Actions::File_ToggleClipboardStoring);
-    m_trayMenu->addSeparator();
-    addTrayAction(Actions::File_Exit);
+    // Menu is updated only partially (only changed items and commands are updated).
+    if ( m_trayMenu->isEmpty() ) {
+        QAction *act = m_trayMenu->addAction(
+                    appIcon(), tr("&Show/Hide"), this, SLOT(toggleVisible()) );
+        m_trayMenu->setDefaultAction(act);
+        addTrayAction(Actions::File_New);
+        act = addTrayAction(Actions::Item_Action);
+        act->setWhatsThis( tr("Open action dialog") );
+        addTrayAction(Actions::File_Preferences);
+        addTrayAction(Actions::File_ToggleClipboardStoring);
+        m_trayMenu->addSeparator();
+        addTrayAction(Actions::File_Exit);
+    }
 
     // Add items.
     const int len = (c != NULL) ? qMin( m_options.trayItems, c->length() ) : 0;
-    const int current = c->currentIndex().row();
-    for ( int i = 0; i < len; ++i ) {
-        const QModelIndex index = c->model()->index(i, 0);
-        m_trayMenu->addClipboardItemAction(index, m_options.trayImages, i == current);
-    }
-
-    // Add commands.
-    if (m_options.trayCommands) {
-        if (c == NULL)
-            c = browser(0);
+    const int current = (c != NULL) ? c->currentIndex().row() : -1;
+    QList<QModelIndex> indexes;
+    for ( int i = 0; i < len; ++i )
+        indexes.append( c->model()->index(i, 0) );
+    m_trayMenu->setClipboardItemActions(indexes, m_options.trayImages, current);
 
-        // Show clipboard content as disabled item.
-        const QString format = tr("&Clipboard: %1", "Tray menu clipboard item format");
-        QAction *act = m_trayMenu->addAction( iconClipboard(),
-                                            QString(), this, SLOT(showClipboardContent()) );
-        act->setText( textLabelForData(m_clipboardData, act->font(), format, true) );
-        m_trayMenu->addCustomAction(act);
-
-        int i = m_trayMenu->actions().size();
-        addCommandsToMenu(m_trayMenu, m_clipboardData);
-        QList<QAction *> actions = m_trayMenu->actions();
-        for ( ; i < actions.size(); ++i )
-            m_trayMenu->addCustomAction(actions[i]);
+    // Add commands (only if clipboard or tab changed).
+    if (c == NULL)
+        c = browser(0);
+    const QString commandsKey = m_options.trayCommands
+            ? commandsKeyForData( m_clipboardData, c ? c->tabName() : QString() )
+            : QString();
+
+    if (commandsKey != m_trayMenuCommandsKey) {
+        m_trayMenuCommandsKey = commandsKey;
+        m_trayMenuCommandTester.abort();
+        m_trayMenu->clearCustomActions();
+
+        if (m_options.trayCommands) {
+            // Show clipboard content as disabled item.
+            const QString format = tr("&Clipboard: %1", "Tray menu clipboard item format");
+            QAction *act = m_trayMenu->addAction( iconClipboard(),
+                                                QString(), this, SLOT(showClipboardContent()) );
+            act->setText( textLabelForData(m_clipboardData, act->font(), format, true) );
+            m_trayMenu->addCustomAction(act);
+
+            int i = m_trayMenu->actions().size();
+            addCommandsToMenu(m_trayMenu, m_clipboardData);
+            QList<QAction *> actions = m_trayMenu->actions();
+            for ( ; i < actions.size(); ++i )
+                m_trayMenu->addCustomAction(actions[i]);
+        }
     }
 
     if (m_trayMenu->activeAction() == NULL)
@@ -2000,6 +2062,7 @@ void MainWindow::clearTrayMenu()
 {
     m_trayMenuCommandTester.abort();
     m_trayMenu->clearAllActions();
+    m_trayMenuCommandsKey.clear();
 }
 
 void MainWindow::openAboutDialog()
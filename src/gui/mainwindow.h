@@ -20,7 +20,9 @@
 #ifndef MAINWINDOW_H
 #define MAINWINDOW_H
 
+#include "common/command.h"
 #include "common/commandtester.h"
+#include "common/textmatcher.h"
 #include "gui/clipboardbrowser.h"
 #include "gui/configtabshortcuts.h"
 
@@ -39,7 +41,6 @@ class NotificationDaemon;
 class QAction;
 class QModelIndex;
 class TrayMenu;
-struct Command;
 struct MainWindowOptions;
 
 Q_DECLARE_METATYPE(QPersistentModelIndex)
@@ -101,6 +102,29 @@ struct MainWindowOptions {
     bool trayItemPaste;
 };
 
+/**
+ * Command with expressions compiled for matching items and window titles.
+ *
+ * Created once when commands are loaded.
+ */
+struct CompiledCommand {
+    CompiledCommand()
+        : command()
+        , matcher()
+        , windowMatcher()
+    {}
+
+    explicit CompiledCommand(const Command &command)
+        : command(command)
+        , matcher(command.re)
+        , windowMatcher(command.wndre)
+    {}
+
+    Command command;
+    TextMatcher matcher;
+    TextMatcher windowMatcher;
+};
+
 /**
  * Application's main window.
  *
@@ -239,6 +263,12 @@ public:
     /** Return true only if monitoring is enabled. */
     bool isMonitoringEnabled() const;
 
+    /**
+     * Return data of item in the first tab with given @a itemHash
+     * or empty map if there is no such item.
+     */
+    QVariantMap firstTabItemData(uint itemHash);
+
     /** Return true if clipboard storing was disabled. */
     bool isClipboardStoringDisabled() const { return m_clipboardStoringDisabled; }
 
@@ -515,6 +545,8 @@ private:
 
     QMenu *m_menuItem;
     TrayMenu *m_trayMenu;
+    /** Clipboard and tab for which custom actions in tray menu were created. */
+    QString m_trayMenuCommandsKey;
 
     QSystemTrayIcon *m_tray;
 
@@ -524,7 +556,7 @@ private:
     QPointer<QAction> m_actionToggleClipboardStoring;
 
     ClipboardBrowserSharedPtr m_sharedData;
-    QList<Command> m_commands;
+    QList<CompiledCommand> m_commands;
 
     PlatformWindowPtr m_lastWindow;
 
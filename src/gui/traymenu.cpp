@@ -28,6 +28,7 @@
 
 #include <QApplication>
 #include <QDesktopWidget>
+#include <QHash>
 #include <QKeyEvent>
 #include <QMimeData>
 #include <QModelIndex>
@@ -38,6 +39,10 @@
 namespace {
 
 const char propertyHasToolTip[] = "CopyQ_has_tooltip";
+const char propertyKeyHint[] = "CopyQ_key_hint";
+const char propertyHasImage[] = "CopyQ_has_image";
+
+const int noKeyHint = -1;
 
 bool canActivate(const QAction &action)
 {
@@ -99,13 +104,47 @@ void drawToolTipIcon(const QRect &actionRect, bool isSelected, QPaintDevice *pai
     painter.drawPixmap( actionRect.right() - size, actionRect.top(), pixmap );
 }
 
+QPixmap imageIcon(const QVariantMap &data)
+{
+    const QStringList formats = data.keys();
+    const int imageIndex = formats.indexOf( QRegExp("^image/.*") );
+    if (imageIndex == -1)
+        return QPixmap();
+
+    const QString &format = formats[imageIndex];
+    QPixmap pix;
+    pix.loadFromData( data.value(format).toByteArray(), format.toLatin1().data() );
+    const int iconSize = 24;
+    int x = 0;
+    int y = 0;
+    if (pix.width() > pix.height()) {
+        pix = pix.scaledToHeight(iconSize);
+        x = (pix.width() - iconSize) / 2;
+    } else {
+        pix = pix.scaledToWidth(iconSize);
+        y = (pix.height() - iconSize) / 2;
+    }
+    return pix.copy(x, y, iconSize, iconSize);
+}
+
+void deleteAction(QAction *action, QMenu *menu)
+{
+    // Delete sub-menu created for the action.
+    QMenu *subMenu = action->menu();
+    if (subMenu != NULL && subMenu->parentWidget() == menu)
+        delete subMenu;
+    else
+        delete action;
+}
+
 } // namespace
 
 TrayMenu::TrayMenu(QWidget *parent)
     : QMenu(parent)
     , m_clipboardItemActionsSeparator()
     , m_customActionsSeparator()
-    , m_clipboardItemActionCount(0)
+    , m_clipboardItemActions()
+    , m_customActions()
     , m_omitPaste(false)
 {
     connect( this, SIGNAL(hovered(QAction*)),
@@ -137,73 +176,74 @@ void TrayMenu::toggle()
         window->raise();
 }
 
-void TrayMenu::addClipboardItemAction(const QModelIndex &index, bool showImages, bool isCurrent)
+void TrayMenu::setClipboardItemActions(const QList<QModelIndex> &indexes, bool showImages, int currentRow)
 {
-    QAction *act;
+    // History can contain same items so there can be more actions with same hash.
+    QHash< uint, QList<QAction*> > oldActions;
+    foreach (QAction *act, m_clipboardItemActions) {
+        if (act != NULL)
+            oldActions[ act->data().toUInt() ].append(act);
+    }
 
-    const QVariantMap data = index.data(contentType::data).toMap();
-    const QString text = getTextData(data);
-    act = addAction(text);
-    act->setWhatsThis(text);
+    QList< QPointer<QAction> > actions;
+    QAction *currentAction = NULL;
 
-    act->setData(index.data(contentType::hash));
+    for (int i = 0; i < indexes.size(); ++i) {
+        const QModelIndex &index = indexes[i];
+        QAction *act = NULL;
+        QHash< uint, QList<QAction*> >::iterator it =
+                oldActions.find( index.data(contentType::hash).toUInt() );
+        if ( it != oldActions.end() && !it.value().isEmpty() )
+            act = it.value().takeFirst();
+        else
+            act = createClipboardItemAction(index);
 
-    resetSeparators();
-    insertAction(m_clipboardItemActionsSeparator, act);
+        // Add number key hint.
+        const int keyHint = i < 10 ? i : noKeyHint;
+        updateClipboardItemAction(act, index, keyHint, showImages);
 
-    QString format;
+        actions.append(act);
 
-    // Add number key hint.
-    if (m_clipboardItemActionCount < 10) {
-        format = tr("&%1. %2",
-                    "Key hint (number shortcut) for items in tray menu (%1 is number, %2 is item label)")
-                .arg(m_clipboardItemActionCount++);
+        if (index.row() == currentRow)
+            currentAction = act;
     }
 
-    const QString label = textLabelForData( data, act->font(), format, true );
-    act->setText(label);
-
-    setActionToolTip( act, index.data(contentType::notes).toString() );
+    foreach (const QList<QAction*> &unusedActions, oldActions)
+        qDeleteAll(unusedActions);
 
-    // Menu item icon from image.
-    if (showImages) {
-        const QStringList formats = data.keys();
-        const int imageIndex = formats.indexOf( QRegExp("^image/.*") );
-        if (imageIndex != -1) {
-            const QString &format = formats[imageIndex];
-            QPixmap pix;
-            pix.loadFromData( data.value(format).toByteArray(), format.toLatin1().data() );
-            const int iconSize = 24;
-            int x = 0;
-            int y = 0;
-            if (pix.width() > pix.height()) {
-                pix = pix.scaledToHeight(iconSize);
-                x = (pix.width() - iconSize) / 2;
-            } else {
-                pix = pix.scaledToWidth(iconSize);
-                y = (pix.height() - iconSize) / 2;
-            }
-            pix = pix.copy(x, y, iconSize, iconSize);
-            act->setIcon(pix);
-        }
+    // Reorder actions only if needed.
+    if (actions != m_clipboardItemActions) {
+        resetSeparators();
+        foreach (QAction *act, actions)
+            insertAction(m_clipboardItemActionsSeparator, act);
+        m_clipboardItemActions = actions;
     }
 
-    connect(act, SIGNAL(triggered()), this, SLOT(onClipboardItemActionTriggered()));
-
-    if (isCurrent)
-        setActiveAction(act);
+    if (currentAction != NULL)
+        setActiveAction(currentAction);
 }
 
 void TrayMenu::addCustomAction(QAction *action)
 {
     resetSeparators();
     insertAction(m_customActionsSeparator, action);
+    m_customActions.append(action);
+}
+
+void TrayMenu::clearCustomActions()
+{
+    foreach (QAction *act, m_customActions) {
+        if (act != NULL)
+            deleteAction(act, this);
+    }
+    m_customActions.clear();
 }
 
 void TrayMenu::clearAllActions()
 {
+    clearCustomActions();
     clear();
-    m_clipboardItemActionCount = 0;
+    m_clipboardItemActions.clear();
 }
 
 void TrayMenu::setActiveFirstEnabledAction()
@@ -284,6 +324,52 @@ void TrayMenu::resetSeparators()
         m_clipboardItemActionsSeparator = insertSeparator(m_customActionsSeparator);
 }
 
+QAction *TrayMenu::createClipboardItemAction(const QModelIndex &index)
+{
+    QAction *act = new QAction(this);
+    act->setData(index.data(contentType::hash));
+    // Label is set in updateClipboardItemAction().
+    act->setProperty(propertyKeyHint, noKeyHint - 1);
+    act->setProperty(propertyHasImage, false);
+
+    setActionToolTip( act, index.data(contentType::notes).toString() );
+
+    connect(act, SIGNAL(triggered()), this, SLOT(onClipboardItemActionTriggered()));
+
+    return act;
+}
+
+void TrayMenu::updateClipboardItemAction(QAction *act, const QModelIndex &index, int keyHint, bool showImages)
+{
+    const bool updateLabel = act->property(propertyKeyHint).toInt() != keyHint;
+    const bool updateIcon = act->property(propertyHasImage).toBool() != showImages;
+    if (!updateLabel && !updateIcon)
+        return;
+
+    const QVariantMap data = index.data(contentType::data).toMap();
+
+    if (updateLabel) {
+        act->setProperty(propertyKeyHint, keyHint);
+
+        QString format;
+        if (keyHint != noKeyHint) {
+            format = tr("&%1. %2",
+                        "Key hint (number shortcut) for items in tray menu (%1 is number, %2 is item label)")
+                    .arg(keyHint);
+        }
+
+        act->setText( textLabelForData(data, act->font(), format, true) );
+        act->setWhatsThis( getTextData(data) );
+    }
+
+    if (updateIcon) {
+        act->setProperty(propertyHasImage, showImages);
+
+        // Menu item icon from image.
+        act->setIcon( showImages ? QIcon(imageIcon(data)) : QIcon() );
+    }
+}
+
 void TrayMenu::onClipboardItemActionTriggered()
 {
     QAction *act = qobject_cast<QAction *>(sender());
@@ -20,6 +20,7 @@
 #ifndef TRAYMENU_H
 #define TRAYMENU_H
 
+#include <QList>
 #include <QMenu>
 #include <QPointer>
 #include <QTimer>
@@ -36,15 +37,21 @@ public:
     void toggle();
 
     /**
-     * Add clipboard item action with number key hint.
+     * Set clipboard item actions (with number key hints) for items at @a indexes.
      *
-     * Triggering this action emits clipboardItemActionTriggered() signal.
+     * Actions for items already in menu (with same hash) are kept so labels and icons
+     * are not created again.
+     *
+     * Triggering these actions emits clipboardItemActionTriggered() signal.
      */
-    void addClipboardItemAction(const QModelIndex &index, bool showImages, bool isCurrent);
+    void setClipboardItemActions(const QList<QModelIndex> &indexes, bool showImages, int currentRow);
 
     /** Add custom action. */
     void addCustomAction(QAction *action);
 
+    /** Remove custom actions (and their sub-menus). */
+    void clearCustomActions();
+
     /** Clear clipboard item actions and curstom actions. */
     void clearAllActions();
 
@@ -70,9 +77,15 @@ protected:
 private:
     void resetSeparators();
 
+    QAction *createClipboardItemAction(const QModelIndex &index);
+
+    /** Update label (if key hint changed) and icon (if enabled or disabled). */
+    void updateClipboardItemAction(QAction *act, const QModelIndex &index, int keyHint, bool showImages);
+
     QPointer<QAction> m_clipboardItemActionsSeparator;
     QPointer<QAction> m_customActionsSeparator;
-    int m_clipboardItemActionCount;
+    QList< QPointer<QAction> > m_clipboardItemActions;
+    QList< QPointer<QAction> > m_customActions;
 
     QTimer m_timerShowTooltip;
 
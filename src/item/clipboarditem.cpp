@@ -44,6 +44,8 @@ void clearDataExceptInternal(QVariantMap *data)
 ClipboardItem::ClipboardItem()
     : m_data()
     , m_hash(0)
+    , m_searchableTexts()
+    , m_searchableTextsVersion(-1)
 {
 }
 
@@ -61,7 +63,7 @@ void ClipboardItem::setText(const QString &text)
 
     setTextData(&m_data, text);
 
-    invalidateDataHash();
+    invalidateCachedData();
 }
 
 bool ClipboardItem::setData(const QVariantMap &data)
@@ -70,7 +72,7 @@ bool ClipboardItem::setData(const QVariantMap &data)
         return false;
 
     m_data = data;
-    invalidateDataHash();
+    invalidateCachedData();
     return true;
 }
 
@@ -93,7 +95,7 @@ bool ClipboardItem::updateData(const QVariantMap &data)
         }
     }
 
-    invalidateDataHash();
+    invalidateCachedData();
 
     return changed;
 }
@@ -101,7 +103,7 @@ bool ClipboardItem::updateData(const QVariantMap &data)
 void ClipboardItem::removeData(const QString &mimeType)
 {
     m_data.remove(mimeType);
-    invalidateDataHash();
+    invalidateCachedData();
 }
 
 bool ClipboardItem::removeData(const QStringList &mimeTypeList)
@@ -116,7 +118,7 @@ bool ClipboardItem::removeData(const QStringList &mimeTypeList)
     }
 
     if (removed)
-        invalidateDataHash();
+        invalidateCachedData();
 
     return removed;
 }
@@ -124,7 +126,7 @@ bool ClipboardItem::removeData(const QStringList &mimeTypeList)
 void ClipboardItem::setData(const QString &mimeType, const QByteArray &data)
 {
     m_data.insert(mimeType, data);
-    invalidateDataHash();
+    invalidateCachedData();
 }
 
 QVariant ClipboardItem::data(int role) const
@@ -165,7 +167,24 @@ unsigned int ClipboardItem::dataHash() const
     return m_hash;
 }
 
-void ClipboardItem::invalidateDataHash()
+bool ClipboardItem::searchableTexts(int version, QStringList *texts) const
+{
+    if (m_searchableTextsVersion == -1 || m_searchableTextsVersion != version)
+        return false;
+
+    *texts = m_searchableTexts;
+    return true;
+}
+
+void ClipboardItem::setSearchableTexts(const QStringList &texts, int version)
+{
+    m_searchableTexts = texts;
+    m_searchableTextsVersion = version;
+}
+
+void ClipboardItem::invalidateCachedData()
 {
     m_hash = 0;
+    m_searchableTexts.clear();
+    m_searchableTextsVersion = -1;
 }
@@ -20,10 +20,11 @@
 #ifndef CLIPBOARDITEM_H
 #define CLIPBOARDITEM_H
 
+#include <QString>
+#include <QStringList>
 #include <QVariant>
 
 class QByteArray;
-class QString;
 
 /**
  * Class for clipboard items in ClipboardModel.
@@ -75,11 +76,23 @@ public:
     /** Return hash for item's data. */
     unsigned int dataHash() const;
 
+    /**
+     * Get cached texts for searching.
+     * Returns false if texts are not cached, item data changed since
+     * or texts were cached for different @a version of item loaders.
+     */
+    bool searchableTexts(int version, QStringList *texts) const;
+
+    /** Cache texts for searching until item data or @a version of item loaders change. */
+    void setSearchableTexts(const QStringList &texts, int version);
+
 private:
-    void invalidateDataHash();
+    void invalidateCachedData();
 
     QVariantMap m_data;
     mutable unsigned int m_hash;
+    QStringList m_searchableTexts;
+    int m_searchableTextsVersion;
 };
 
 #endif // CLIPBOARDITEM_H
@@ -305,3 +305,13 @@ int ClipboardModel::findItem(uint item_hash) const
 
     return -1;
 }
+
+bool ClipboardModel::searchableTexts(int row, int version, QStringList *texts) const
+{
+    return m_clipboardList[row].searchableTexts(version, texts);
+}
+
+void ClipboardModel::setSearchableTexts(int row, const QStringList &texts, int version)
+{
+    m_clipboardList[row].setSearchableTexts(texts, version);
+}
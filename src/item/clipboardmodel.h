@@ -183,6 +183,15 @@ public:
      */
     int findItem(uint hash) const;
 
+    /**
+     * Get cached texts for searching in item in given @a row.
+     * @return false if the texts are not cached for given @a version of item loaders.
+     */
+    bool searchableTexts(int row, int version, QStringList *texts) const;
+
+    /** Cache texts for searching in item in given @a row (until item data change). */
+    void setSearchableTexts(int row, const QStringList &texts, int version);
+
     /**
      * Return row index for given @a row.
      * @return Value of @a row if such index is in model.
@@ -28,15 +28,47 @@
 #include "item/itemeditorwidget.h"
 
 #include <QApplication>
+#include <QBuffer>
 #include <QDesktopWidget>
 #include <QEvent>
 #include <QAbstractItemView>
+#include <QFontMetrics>
+#include <QImageReader>
 #include <QPainter>
+#include <QPair>
+#include <QVariantMap>
+#include <QVector>
 
 namespace {
 
 const char propertySelectedItem[] = "CopyQ_selected";
 
+/// Default size hint for items which were not rendered yet.
+const QSize defaultItemSize(0, 512);
+
+/// Number of rows in block of height index (block is split if it has twice as much rows).
+const int heightBlockSize = 64;
+
+/** Return size from header of first image in item, invalid size if unknown. */
+QSize imageSizeFromHeader(const QModelIndex &index)
+{
+    const QVariantMap data = index.data(contentType::data).toMap();
+    foreach ( const QString &format, data.keys() ) {
+        if ( !format.startsWith("image/") )
+            continue;
+
+        QByteArray bytes = data[format].toByteArray();
+        QBuffer buffer(&bytes);
+        buffer.open(QIODevice::ReadOnly);
+        QImageReader reader( &buffer, format.mid(6).toLatin1() ); // skip "image/"
+        const QSize imageSize = reader.size();
+        if ( imageSize.isValid() )
+            return imageSize;
+    }
+
+    return QSize();
+}
+
 inline void reset(ItemWidget **ptr, ItemWidget *value = NULL)
 {
     delete *ptr;
@@ -56,6 +88,7 @@ ItemDelegate::ItemDelegate(QAbstractItemView *view, QWidget *parent)
     , m_view(view)
     , m_saveOnReturnKey(true)
     , m_re()
+    , m_matcher()
     , m_maxSize(2048, 2048 * 8)
     , m_idealWidth(0)
     , m_vMargin( itemMargin() )
@@ -68,6 +101,12 @@ ItemDelegate::ItemDelegate(QAbstractItemView *view, QWidget *parent)
     , m_rowNumberPalette()
     , m_antialiasing(true)
     , m_cache()
+    , m_cachedWidgetCount(0)
+    , m_maxCachedWidgets(100)
+    , m_useCounter(0)
+    , m_heightBlocks()
+    , m_heightIndexDirty(true)
+    , m_widgetIndexes()
 {
 }
 
@@ -77,16 +116,19 @@ ItemDelegate::~ItemDelegate()
 
 QSize ItemDelegate::sizeHint(const QModelIndex &index) const
 {
-    int row = index.row();
+    return rowSizeHint( index.row() );
+}
+
+QSize ItemDelegate::rowSizeHint(int row) const
+{
     if ( row < m_cache.size() ) {
-        const ItemWidget *w = m_cache[row];
-        if (w != NULL) {
-            QWidget *ww = w->widget();
-            return QSize( ww->width() + 2 * m_hMargin + rowNumberWidth(),
-                          qMax(ww->height() + 2 * m_vMargin, rowNumberHeight()) );
-        }
+        const CachedItem &item = m_cache[row];
+        if (item.widget != NULL)
+            return widgetSizeHint(item.widget);
+        if ( item.size.isValid() )
+            return item.size;
     }
-    return QSize(0, 512);
+    return defaultItemSize;
 }
 
 QSize ItemDelegate::sizeHint(const QStyleOptionViewItem &,
@@ -95,11 +137,17 @@ QSize ItemDelegate::sizeHint(const QStyleOptionViewItem &,
     return sizeHint(index);
 }
 
-bool ItemDelegate::eventFilter(QObject *, QEvent *event)
+bool ItemDelegate::eventFilter(QObject *object, QEvent *event)
 {
     // resize event for items
-    if ( event->type() == QEvent::Resize )
+    if ( event->type() == QEvent::Resize ) {
+        const QPersistentModelIndex index = m_widgetIndexes.value(object);
+        if ( index.isValid() )
+            updateHeightIndex( index.row() );
+        else
+            m_heightIndexDirty = true;
         emit rowSizeChanged();
+    }
 
     return false;
 }
@@ -111,50 +159,119 @@ void ItemDelegate::dataChanged(const QModelIndex &a, const QModelIndex &b)
     // - recalculate size only if item edited
     int row = a.row();
     if ( row == b.row() ) {
-        reset(&m_cache[row]);
+        releaseWidget(row);
+        m_cache[row].size = QSize();
+        m_cache[row].imageSizeChecked = false;
+        updateHeightIndex(row);
         emit rowSizeChanged();
     }
 }
 
 void ItemDelegate::rowsRemoved(const QModelIndex &, int start, int end)
 {
+    unindexRows(start, end);
     for( int i = end; i >= start; --i ) {
-        delete m_cache.takeAt(i);
+        releaseWidget(i);
+        m_cache.removeAt(i);
     }
 }
 
 void ItemDelegate::rowsMoved(const QModelIndex &, int sourceStart, int sourceEnd,
                              const QModelIndex &, int destinationRow)
 {
+    unindexRows(sourceStart, sourceEnd);
+
     int dest = sourceStart < destinationRow ? destinationRow-1 : destinationRow;
     for( int i = sourceStart; i <= sourceEnd; ++i ) {
         m_cache.move(i,dest);
         ++dest;
     }
+
+    const int count = sourceEnd - sourceStart + 1;
+    const int start = sourceStart < destinationRow ? destinationRow - count : destinationRow;
+    indexRows(start, start + count - 1);
 }
 
 void ItemDelegate::rowsInserted(const QModelIndex &, int start, int end)
 {
     for( int i = start; i <= end; ++i )
-        m_cache.insert(i, NULL);
+        m_cache.insert( i, CachedItem() );
+    indexRows(start, end);
 }
 
 ItemWidget *ItemDelegate::cache(const QModelIndex &index)
 {
     int n = index.row();
 
-    ItemWidget *w = m_cache[n];
+    ItemWidget *w = m_cache[n].widget;
     if (w == NULL) {
         w = ConfigurationManager::instance()->itemFactory()->createItem(index, m_view->viewport());
         setIndexWidget(index, w);
     }
 
+    m_cache[n].lastUse = ++m_useCounter;
+
     return w;
 }
 
 bool ItemDelegate::hasCache(const QModelIndex &index) const
 {
-    return m_cache[index.row()] != NULL;
+    return m_cache[index.row()].widget != NULL;
+}
+
+void ItemDelegate::setRowHidden(int row, bool hidden)
+{
+    m_cache[row].hidden = hidden;
+    updateHeightIndex(row);
+}
+
+int ItemDelegate::rowAtOffset(int y, int spacing, int *rowBottom)
+{
+    if (m_heightIndexDirty)
+        rebuildHeightIndex();
+
+    // Each visible row takes its height and spacing above and below the row.
+    const int rowSpacing = 2 * spacing;
+    const int target = qMax(1, y + spacing);
+
+    // Skip whole blocks before target bottom edge position.
+    int row = 0;
+    int top = 0;
+    int b = 0;
+    for ( ; b < m_heightBlocks.size(); ++b ) {
+        const HeightBlock &block = m_heightBlocks[b];
+        const int h = block.height + rowSpacing * block.visibleCount;
+        if (top + h >= target)
+            break;
+        row += block.rowCount;
+        top += h;
+    }
+
+    if ( b == m_heightBlocks.size() )
+        return -1;
+
+    // Find first row in block with bottom edge at or below target.
+    const int lastRow = row + m_heightBlocks[b].rowCount;
+    for ( ; row < lastRow; ++row ) {
+        const CachedItem &item = m_cache[row];
+        const int h = item.indexedHeight + (item.indexedVisible ? rowSpacing : 0);
+        if (top + h >= target)
+            break;
+        top += h;
+    }
+
+    if (row >= lastRow)
+        return -1;
+
+    if (rowBottom != NULL)
+        *rowBottom = top + spacing + m_cache[row].indexedHeight;
+
+    return row;
+}
+
+void ItemDelegate::setMaximumCachedWidgets(int count)
+{
+    m_maxCachedWidgets = count;
 }
 
 void ItemDelegate::setItemSizes(const QSize &size, int idealWidth)
@@ -164,29 +281,43 @@ void ItemDelegate::setItemSizes(const QSize &size, int idealWidth)
     m_idealWidth = idealWidth - margins;
 
     for( int i = 0; i < m_cache.length(); ++i ) {
-        ItemWidget *w = m_cache[i];
+        ItemWidget *w = m_cache[i].widget;
         if (w != NULL)
             w->updateSize(m_maxSize, m_idealWidth);
+        else
+            m_cache[i].size = QSize(); // estimate again for new size
     }
+
+    m_heightIndexDirty = true;
 }
 
 void ItemDelegate::updateRowPosition(int row, int y)
 {
-    ItemWidget *w = m_cache[row];
+    ItemWidget *w = m_cache[row].widget;
     if (w != NULL)
         w->widget()->move( QPoint(rowNumberWidth() + m_hMargin, y + m_vMargin) );
 }
 
 void ItemDelegate::setRowVisible(int row, bool visible)
 {
-    ItemWidget *w = m_cache[row];
+    ItemWidget *w = m_cache[row].widget;
     if (w != NULL)
         w->widget()->setVisible(visible);
 }
 
+void ItemDelegate::hideRowsOutside(int firstRow, int lastRow)
+{
+    QHash<const QObject *, QPersistentModelIndex>::const_iterator it;
+    for ( it = m_widgetIndexes.constBegin(); it != m_widgetIndexes.constEnd(); ++it ) {
+        const int row = it.value().row();
+        if ( row != -1 && row < m_cache.size() && (row < firstRow || row > lastRow) )
+            setRowVisible(row, false);
+    }
+}
+
 void ItemDelegate::nextItemLoader(const QModelIndex &index)
 {
-    ItemWidget *w = m_cache[index.row()];
+    ItemWidget *w = m_cache[index.row()].widget;
     if (w != NULL) {
         ItemWidget *w2 = ConfigurationManager::instance()->itemFactory()->nextItemLoader(index, w);
         if (w2 != NULL)
@@ -196,7 +327,7 @@ void ItemDelegate::nextItemLoader(const QModelIndex &index)
 
 void ItemDelegate::previousItemLoader(const QModelIndex &index)
 {
-    ItemWidget *w = m_cache[index.row()];
+    ItemWidget *w = m_cache[index.row()].widget;
     if (w != NULL) {
         ItemWidget *w2 = ConfigurationManager::instance()->itemFactory()->previousItemLoader(index, w);
         if (w2 != NULL)
@@ -208,7 +339,7 @@ ItemEditorWidget *ItemDelegate::createCustomEditor(QWidget *parent, const QModel
                                                    bool editNotes)
 {
     cache(index);
-    ItemEditorWidget *editor = new ItemEditorWidget(m_cache[index.row()], index, editNotes, parent);
+    ItemEditorWidget *editor = new ItemEditorWidget(m_cache[index.row()].widget, index, editNotes, parent);
     loadEditorSettings(editor);
     return editor;
 }
@@ -222,7 +353,14 @@ void ItemDelegate::loadEditorSettings(ItemEditorWidget *editor)
 
 void ItemDelegate::setIndexWidget(const QModelIndex &index, ItemWidget *w)
 {
-    reset(&m_cache[index.row()], w);
+    CachedItem &item = m_cache[index.row()];
+    if (item.widget == NULL && w != NULL)
+        ++m_cachedWidgetCount;
+    else if (item.widget != NULL && w == NULL)
+        --m_cachedWidgetCount;
+    if (item.widget != NULL)
+        m_widgetIndexes.remove( item.widget->widget() );
+    reset(&item.widget, w);
     if (w == NULL)
         return;
 
@@ -241,6 +379,9 @@ void ItemDelegate::setIndexWidget(const QModelIndex &index, ItemWidget *w)
     w->updateSize(m_maxSize, m_idealWidth);
     ww->hide();
 
+    updateHeightIndex( index.row() );
+
+    m_widgetIndexes.insert( ww, QPersistentModelIndex(index) );
     ww->installEventFilter(this);
 
     w->setCurrent(m_view->currentIndex() == index);
@@ -248,6 +389,223 @@ void ItemDelegate::setIndexWidget(const QModelIndex &index, ItemWidget *w)
     emit rowSizeChanged();
 }
 
+void ItemDelegate::releaseWidget(int row)
+{
+    CachedItem &item = m_cache[row];
+    if (item.widget == NULL)
+        return;
+
+    item.size = widgetSizeHint(item.widget);
+    m_widgetIndexes.remove( item.widget->widget() );
+    reset(&item.widget);
+    --m_cachedWidgetCount;
+}
+
+void ItemDelegate::releaseUnusedWidgets()
+{
+    if (m_maxCachedWidgets <= 0 || m_cachedWidgetCount <= m_maxCachedWidgets)
+        return;
+
+    // Release more widgets than needed so this doesn't happen after each new widget.
+    QVector< QPair<uint, int> > unused;
+    const int currentRow = m_view->currentIndex().row();
+    for( int i = 0; i < m_cache.length(); ++i ) {
+        const ItemWidget *w = m_cache[i].widget;
+        if ( w != NULL && i != currentRow && w->widget()->isHidden() )
+            unused.append( qMakePair(m_cache[i].lastUse, i) );
+    }
+
+    const int count = qMin( unused.size(), m_cachedWidgetCount - m_maxCachedWidgets * 3 / 4 );
+    if (count <= 0)
+        return;
+
+    qSort(unused);
+    for (int i = 0; i < count; ++i)
+        releaseWidget(unused[i].second);
+}
+
+void ItemDelegate::updateHeightIndex(int row)
+{
+    if (m_heightIndexDirty)
+        return;
+
+    CachedItem &item = m_cache[row];
+    if ( !item.hidden )
+        estimateSize(row);
+    const int height = item.hidden ? 0 : rowSizeHint(row).height();
+    const int dh = height - item.indexedHeight;
+    const int dc = (item.hidden ? 0 : 1) - (item.indexedVisible ? 1 : 0);
+    if (dh == 0 && dc == 0)
+        return;
+
+    item.indexedHeight = height;
+    item.indexedVisible = !item.hidden;
+
+    int firstRow;
+    HeightBlock &block = m_heightBlocks[ heightBlockIndex(row, &firstRow) ];
+    block.height += dh;
+    block.visibleCount += dc;
+}
+
+void ItemDelegate::rebuildHeightIndex()
+{
+    m_heightBlocks.clear();
+    m_heightBlocks.append( HeightBlock() );
+    m_heightIndexDirty = false;
+
+    if ( !m_cache.isEmpty() )
+        indexRows( 0, m_cache.size() - 1 );
+}
+
+int ItemDelegate::heightBlockIndex(int row, int *firstRow) const
+{
+    *firstRow = 0;
+    const int lastBlock = m_heightBlocks.size() - 1;
+    for (int b = 0; b < lastBlock; ++b) {
+        const int rowCount = m_heightBlocks[b].rowCount;
+        if (row < *firstRow + rowCount)
+            return b;
+        *firstRow += rowCount;
+    }
+
+    return lastBlock;
+}
+
+void ItemDelegate::indexRows(int start, int end)
+{
+    if (m_heightIndexDirty)
+        return;
+
+    if ( m_heightBlocks.isEmpty() )
+        m_heightBlocks.append( HeightBlock() );
+
+    int firstRow;
+    const int b = heightBlockIndex(start, &firstRow);
+    HeightBlock &block = m_heightBlocks[b];
+
+    for (int row = start; row <= end; ++row) {
+        CachedItem &item = m_cache[row];
+        if ( !item.hidden )
+            estimateSize(row);
+        item.indexedHeight = item.hidden ? 0 : rowSizeHint(row).height();
+        item.indexedVisible = !item.hidden;
+
+        ++block.rowCount;
+        block.height += item.indexedHeight;
+        block.visibleCount += item.indexedVisible ? 1 : 0;
+    }
+
+    if (block.rowCount > 2 * heightBlockSize)
+        splitHeightBlock(b, firstRow);
+}
+
+void ItemDelegate::unindexRows(int start, int end)
+{
+    if (m_heightIndexDirty)
+        return;
+
+    int firstRow;
+    int b = heightBlockIndex(start, &firstRow);
+    int blockEnd = firstRow + m_heightBlocks[b].rowCount;
+
+    for (int row = start; row <= end; ++row) {
+        while (row >= blockEnd && b + 1 < m_heightBlocks.size())
+            blockEnd += m_heightBlocks[++b].rowCount;
+
+        HeightBlock &block = m_heightBlocks[b];
+        const CachedItem &item = m_cache[row];
+        --block.rowCount;
+        block.height -= item.indexedHeight;
+        block.visibleCount -= item.indexedVisible ? 1 : 0;
+    }
+
+    // Keep at least one (possibly empty) block for new rows.
+    for (int i = m_heightBlocks.size() - 1; i >= 0 && m_heightBlocks.size() > 1; --i) {
+        if (m_heightBlocks[i].rowCount == 0)
+            m_heightBlocks.remove(i);
+    }
+}
+
+void ItemDelegate::splitHeightBlock(int blockIndex, int firstRow)
+{
+    const int lastRow = firstRow + m_heightBlocks[blockIndex].rowCount;
+
+    QVector<HeightBlock> blocks;
+    for (int row = firstRow; row < lastRow; ++row) {
+        if ( blocks.isEmpty() || blocks.last().rowCount == heightBlockSize )
+            blocks.append( HeightBlock() );
+
+        HeightBlock &block = blocks.last();
+        const CachedItem &item = m_cache[row];
+        ++block.rowCount;
+        block.height += item.indexedHeight;
+        block.visibleCount += item.indexedVisible ? 1 : 0;
+    }
+
+    m_heightBlocks[blockIndex] = blocks[0];
+    m_heightBlocks.insert( blockIndex + 1, blocks.size() - 1, HeightBlock() );
+    for (int i = 1; i < blocks.size(); ++i)
+        m_heightBlocks[blockIndex + i] = blocks[i];
+}
+
+void ItemDelegate::estimateSize(int row)
+{
+    CachedItem &item = m_cache[row];
+    if ( item.widget != NULL || item.size.isValid() )
+        return;
+
+    const QModelIndex index = m_view->model()->index(row, 0);
+    const int maxWidth = qMax(1, m_maxSize.width());
+    QSize size;
+
+    // Use image size from image header (header is decoded only once).
+    if (!item.imageSizeChecked) {
+        item.imageSizeChecked = true;
+        item.imageSize = imageSizeFromHeader(index);
+    }
+
+    // Scale image as image plugin does.
+    const QSize maxImageSize =
+            ConfigurationManager::instance()->itemFactory()->maximumImageSize();
+    if ( item.imageSize.isValid() && maxImageSize.isValid() ) {
+        size = item.imageSize;
+        const QSize boundary(
+                    maxImageSize.width() > 0 ? maxImageSize.width() : size.width(),
+                    maxImageSize.height() > 0 ? maxImageSize.height() : size.height() );
+        if ( size.width() > boundary.width() || size.height() > boundary.height() )
+            size.scale(boundary, Qt::KeepAspectRatio);
+        if ( size.width() > maxWidth )
+            size.scale(maxWidth, size.height(), Qt::KeepAspectRatio);
+    }
+
+    // Count lines of text (including lines wrapped to maximum width).
+    if ( !size.isValid() ) {
+        QString text = index.data(contentType::text).toString();
+        const QString notes = index.data(contentType::notes).toString();
+        if ( !notes.isEmpty() )
+            text.append('\n' + notes);
+
+        const QFontMetrics fm( m_view->font() );
+        const int lines = text.count('\n') + 1;
+        const int textWidth = text.size() * fm.averageCharWidth();
+        const int wrappedLines = textWidth / maxWidth + 1;
+        size = QSize( qMin(textWidth, maxWidth), qMax(lines, wrappedLines) * fm.lineSpacing() );
+    }
+
+    item.size = itemSizeHint( size.boundedTo(m_maxSize) );
+}
+
+QSize ItemDelegate::widgetSizeHint(const ItemWidget *w) const
+{
+    return itemSizeHint( w->widget()->size() );
+}
+
+QSize ItemDelegate::itemSizeHint(const QSize &widgetSize) const
+{
+    return QSize( widgetSize.width() + 2 * m_hMargin + rowNumberWidth(),
+                  qMax(widgetSize.height() + 2 * m_vMargin, rowNumberHeight()) );
+}
+
 int ItemDelegate::rowNumberWidth() const
 {
     return m_showRowNumber ? m_rowNumberSize.width() : 0;
@@ -260,13 +618,17 @@ int ItemDelegate::rowNumberHeight() const
 
 void ItemDelegate::invalidateCache()
 {
-    for( int i = 0; i < m_cache.length(); ++i )
-        reset(&m_cache[i]);
+    for( int i = 0; i < m_cache.length(); ++i ) {
+        releaseWidget(i);
+        m_cache[i].size = QSize();
+    }
+    m_heightIndexDirty = true;
 }
 
 void ItemDelegate::setSearch(const QRegExp &re)
 {
     m_re = re;
+    m_matcher = TextMatcher(re);
 }
 
 void ItemDelegate::setSearchStyle(const QFont &font, const QPalette &palette)
@@ -287,18 +649,20 @@ void ItemDelegate::setNumberStyle(const QFont &font, const QPalette &palette)
     m_rowNumberSize = QFontMetrics(m_rowNumberFont).boundingRect( QString("0123") ).size()
             + QSize(m_hMargin / 2, 2 * m_vMargin);
     m_rowNumberPalette = palette;
+    m_heightIndexDirty = true;
 }
 
 void ItemDelegate::setRowNumberVisibility(bool visible)
 {
     m_showRowNumber = visible;
+    m_heightIndexDirty = true;
 }
 
 void ItemDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option,
                          const QModelIndex &index) const
 {
     int row = index.row();
-    ItemWidget *w = m_cache[row];
+    ItemWidget *w = m_cache[row].widget;
     if (w == NULL)
         return;
 
@@ -323,7 +687,7 @@ void ItemDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option,
     }
 
     /* highlight search string */
-    w->setHighlight(m_re, m_foundFont, m_foundPalette);
+    w->setHighlight(m_matcher, m_foundFont, m_foundPalette);
 
     /* text color for selected/unselected item */
     QWidget *ww = w->widget();
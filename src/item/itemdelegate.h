@@ -20,8 +20,13 @@
 #ifndef ITEMDELEGATE_H
 #define ITEMDELEGATE_H
 
+#include "common/textmatcher.h"
+
+#include <QHash>
 #include <QItemDelegate>
+#include <QPersistentModelIndex>
 #include <QRegExp>
+#include <QVector>
 
 class Item;
 class ItemEditorWidget;
@@ -64,6 +69,9 @@ class ItemDelegate : public QItemDelegate
         /** Return regular expression for highlighting. */
         const QRegExp &searchExpression() const { return m_re; }
 
+        /** Return matcher for filtering items. */
+        const TextMatcher &searchMatcher() const { return m_matcher; }
+
         /** Search highlight style. */
         void setSearchStyle(const QFont &font, const QPalette &palette);
 
@@ -82,6 +90,20 @@ class ItemDelegate : public QItemDelegate
         /** Return true only if item at index is already in cache. */
         bool hasCache(const QModelIndex &index) const;
 
+        /**
+         * Set maximum number of cached item widgets (non-positive for unlimited).
+         *
+         * If there are more widgets, least recently used hidden widgets are released
+         * (size of released items is kept until they are cached again).
+         */
+        void setMaximumCachedWidgets(int count);
+
+        /**
+         * Release least recently used hidden widgets if there are too many.
+         * Widgets outside viewport and preloaded area should be hidden before calling this.
+         */
+        void releaseUnusedWidgets();
+
         /** Set maximum size for all items. */
         void setItemSizes(const QSize &maxSize, int idealWidth);
 
@@ -97,6 +119,27 @@ class ItemDelegate : public QItemDelegate
         /** Show/hide row. */
         void setRowVisible(int row, bool visible);
 
+        /**
+         * Hide rows outside given range.
+         * Only rows with cached widget are checked (not all rows).
+         */
+        void hideRowsOutside(int firstRow, int lastRow);
+
+        /** Exclude hidden (filtered) row from row positions (see rowAtOffset()). */
+        void setRowHidden(int row, bool hidden);
+
+        /**
+         * Return first row which is not hidden and has bottom edge at or below @a y,
+         * -1 if there is no such row.
+         *
+         * Rows are separated by @a spacing as in QListView. If @a rowBottom is not NULL,
+         * it's set to position of bottom edge of the row.
+         *
+         * Row heights are summed in blocks of consecutive rows so only block sums
+         * and rows in single block are visited.
+         */
+        int rowAtOffset(int y, int spacing, int *rowBottom);
+
         /** Use next item loader available for @a index. */
         void nextItemLoader(const QModelIndex &index);
 
@@ -126,14 +169,74 @@ class ItemDelegate : public QItemDelegate
                    const QModelIndex &index) const;
 
     private:
+        struct CachedItem {
+            CachedItem()
+                : widget(NULL), size(), lastUse(0)
+                , hidden(false), indexedHeight(0), indexedVisible(false)
+                , imageSize(), imageSizeChecked(false)
+            {}
+            ItemWidget *widget;
+            QSize size; ///< Last or estimated size hint (used if there is no widget).
+            uint lastUse;
+            bool hidden;
+            int indexedHeight; ///< Height in height index.
+            bool indexedVisible; ///< Row is counted in height index.
+            QSize imageSize; ///< Size from image header (kept until data change).
+            bool imageSizeChecked;
+        };
+
+        /// Sums for consecutive rows in height index.
+        struct HeightBlock {
+            HeightBlock() : rowCount(0), height(0), visibleCount(0) {}
+            int rowCount;
+            int height;
+            int visibleCount; ///< Number of rows which are not hidden.
+        };
+
+        QSize rowSizeHint(int row) const;
+
         void setIndexWidget(const QModelIndex &index, ItemWidget *w);
 
+        /** Delete widget for @a row and remember its size. */
+        void releaseWidget(int row);
+
+        /**
+         * Estimate size of item without widget (if not already known) from text line count
+         * or image dimensions in image header.
+         */
+        void estimateSize(int row);
+
+        QSize widgetSizeHint(const ItemWidget *w) const;
+
+        QSize itemSizeHint(const QSize &widgetSize) const;
+
+        /** Update height of @a row in height index. */
+        void updateHeightIndex(int row);
+
+        void rebuildHeightIndex();
+
+        /**
+         * Return block in height index containing @a row (or last block if row is
+         * not indexed) and set @a firstRow to first row of the block.
+         */
+        int heightBlockIndex(int row, int *firstRow) const;
+
+        /** Add new rows (already in cache) to height index. */
+        void indexRows(int start, int end);
+
+        /** Remove rows (still in cache) from height index. */
+        void unindexRows(int start, int end);
+
+        /** Split block in height index to blocks with default number of rows. */
+        void splitHeightBlock(int blockIndex, int firstRow);
+
         int rowNumberWidth() const;
         int rowNumberHeight() const;
 
         QAbstractItemView  *m_view;
         bool m_saveOnReturnKey;
         QRegExp m_re;
+        TextMatcher m_matcher;
         QSize m_maxSize;
         int m_idealWidth;
         int m_vMargin;
@@ -149,7 +252,17 @@ class ItemDelegate : public QItemDelegate
         QPalette m_rowNumberPalette;
         bool m_antialiasing;
 
-        QList<ItemWidget*> m_cache;
+        QList<CachedItem> m_cache;
+        int m_cachedWidgetCount;
+        int m_maxCachedWidgets;
+        uint m_useCounter;
+
+        // Row heights and number of visible rows summed in blocks.
+        QVector<HeightBlock> m_heightBlocks;
+        bool m_heightIndexDirty;
+
+        /// Rows of cached widgets (to update height index only for resized widget).
+        QHash<const QObject *, QPersistentModelIndex> m_widgetIndexes;
 };
 
 #endif
@@ -204,10 +204,9 @@ public:
         return true;
     }
 
-    bool matches(const QModelIndex &index, const QRegExp &re) const
+    QString searchableText(const QModelIndex &index) const
     {
-        const QString text = index.data(contentType::text).toString();
-        return re.indexIn(text) != -1;
+        return index.data(contentType::text).toString();
     }
 
 private:
@@ -222,6 +221,7 @@ ItemFactory::ItemFactory(QObject *parent)
     , m_dummyLoader(new DummyLoader(this))
     , m_disabledLoaders()
     , m_loaderChildren()
+    , m_searchableTextsVersion(0)
 {
     loadPlugins();
 
@@ -303,6 +303,9 @@ void ItemFactory::setPluginPriority(const QStringList &pluginNames)
 
 void ItemFactory::setLoaderEnabled(const ItemLoaderInterfacePtr &loader, bool enabled)
 {
+    if ( isLoaderEnabled(loader) != enabled )
+        ++m_searchableTextsVersion;
+
     if (enabled)
         m_disabledLoaders.remove(loader);
     else
@@ -337,14 +340,37 @@ ItemLoaderInterfacePtr ItemFactory::initializeTab(QAbstractItemModel *model)
     return ItemLoaderInterfacePtr();
 }
 
-bool ItemFactory::matches(const QModelIndex &index, const QRegExp &re) const
+QStringList ItemFactory::searchableTexts(const QModelIndex &index) const
+{
+    QStringList texts;
+    texts.append( m_dummyLoader->searchableText(index) );
+
+    foreach ( const ItemLoaderInterfacePtr &loader, m_loaders ) {
+        if ( isLoaderEnabled(loader) ) {
+            const QString loaderText = loader->searchableText(index);
+            if ( !loaderText.isEmpty() )
+                texts.append(loaderText);
+        }
+    }
+
+    return texts;
+}
+
+QSize ItemFactory::maximumImageSize() const
 {
     foreach ( const ItemLoaderInterfacePtr &loader, enabledLoaders() ) {
-        if ( isLoaderEnabled(loader) && loader->matches(index, re) )
-            return true;
+        const QSize size = loader->maximumImageSize();
+        if ( size.isValid() )
+            return size;
     }
 
-    return false;
+    return QSize();
+}
+
+void ItemFactory::itemsAboutToBeDeleted(const QList<QModelIndex> &indexList)
+{
+    foreach ( const ItemLoaderInterfacePtr &loader, enabledLoaders() )
+        loader->itemsAboutToBeDeleted(indexList);
 }
 
 QString ItemFactory::scripts() const
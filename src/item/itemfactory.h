@@ -25,6 +25,7 @@
 #include <QMap>
 #include <QObject>
 #include <QSet>
+#include <QStringList>
 #include <QVector>
 
 class ItemLoaderInterface;
@@ -121,9 +122,31 @@ public:
     ItemLoaderInterfacePtr initializeTab(QAbstractItemModel *model);
 
     /**
-     * Return true only if any plugin (ItemLoaderInterface::matches()) returns true;
+     * Return texts to search in from all enabled plugins
+     * (ItemLoaderInterface::searchableText()).
+     *
+     * Item text comes first, non-empty texts from plugins follow.
+     * Filter should match each text separately.
+     */
+    QStringList searchableTexts(const QModelIndex &index) const;
+
+    /**
+     * Return number which changes whenever searchable texts
+     * can change for all items (e.g. a plugin was enabled or disabled).
+     */
+    int searchableTextsVersion() const { return m_searchableTextsVersion; }
+
+    /**
+     * Return maximum size of images from first enabled plugin which shows images
+     * (ItemLoaderInterface::maximumImageSize()).
+     */
+    QSize maximumImageSize() const;
+
+    /**
+     * Notify enabled plugins that items will be removed
+     * (ItemLoaderInterface::itemsAboutToBeDeleted()).
      */
-    bool matches(const QModelIndex &index, const QRegExp &re) const;
+    void itemsAboutToBeDeleted(const QList<QModelIndex> &indexList);
 
     /**
      * Return script to run before client scripts.
@@ -160,6 +183,7 @@ private:
     ItemLoaderInterfacePtr m_dummyLoader;
     QSet<ItemLoaderInterfacePtr> m_disabledLoaders;
     QMap<QObject *, ItemLoaderInterfacePtr> m_loaderChildren;
+    int m_searchableTextsVersion;
 };
 
 #endif // ITEMFACTORY_H
@@ -21,24 +21,300 @@
 
 #include "common/command.h"
 #include "common/contenttype.h"
+#include "common/textmatcher.h"
 #include "item/itemeditor.h"
 
 #include <QAbstractItemModel>
+#include <QCache>
+#include <QCoreApplication>
 #include <QEvent>
 #include <QFont>
 #include <QModelIndex>
 #include <QMouseEvent>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPair>
 #include <QPalette>
+#include <QRunnable>
+#include <QSharedPointer>
+#include <QTextCharFormat>
+#include <QTextCursor>
+#include <QTextDocument>
 #include <QTextEdit>
+#include <QThreadPool>
+#include <QVector>
 #include <QWidget>
 
 namespace {
 
+/// Maximum number of highlighted matches in single text.
+const int maxHighlightCount = 1000;
+
+/// Text shorter than this is searched immediately, longer text is searched in other thread.
+const int maxSynchronousHighlightTextLength = 8 * 1024;
+
+/// Maximum number of cached match positions (for different texts and searches).
+const int highlightCacheSize = 512;
+
+const char highlighterObjectName[] = "CopyQ_highlighter";
+
 bool canMouseInteract(const QMouseEvent &event)
 {
     return event.modifiers() & Qt::ShiftModifier;
 }
 
+/** Positions and lengths of matches in text. */
+typedef QVector< QPair<int, int> > TextMatches;
+
+/**
+ * Return matches in @a text (at most maxHighlightCount).
+ *
+ * Each line is matched separately same as with QTextDocument::find().
+ * Positions in text returned by QTextDocument::toPlainText() are same as in the document.
+ */
+TextMatches findMatches(const QString &text, const TextMatcher &matcher)
+{
+    TextMatches matches;
+
+    int lineStart = 0;
+    while ( lineStart <= text.size() && matches.size() < maxHighlightCount ) {
+        int lineEnd = text.indexOf('\n', lineStart);
+        if (lineEnd == -1)
+            lineEnd = text.size();
+
+        const QString line = text.mid(lineStart, lineEnd - lineStart);
+        int length;
+        for ( int i = matcher.indexIn(line, 0, &length);
+              i != -1 && matches.size() < maxHighlightCount;
+              i = matcher.indexIn(line, i + qMax(1, length), &length) )
+        {
+            if (length > 0)
+                matches.append( qMakePair(lineStart + i, length) );
+        }
+
+        lineStart = lineEnd + 1;
+    }
+
+    return matches;
+}
+
+QString highlightCacheKey(const QString &text, const TextMatcher &matcher)
+{
+    const QRegExp &re = matcher.regExp();
+    return QString("%1:%2:%3:%4:%5:")
+            .arg(qHash(text))
+            .arg(text.size())
+            .arg(re.caseSensitivity())
+            .arg(re.patternSyntax())
+            .arg(re.isMinimal())
+            + re.pattern();
+}
+
+/** Cache of found matches (use only from main thread). */
+QCache<QString, TextMatches> &highlightCache()
+{
+    static QCache<QString, TextMatches> cache(highlightCacheSize);
+    return cache;
+}
+
+QEvent::Type matchesFoundEventType()
+{
+    static const QEvent::Type type = static_cast<QEvent::Type>(QEvent::registerEventType());
+    return type;
+}
+
+/**
+ * Text and matches shared between main thread and thread searching the text.
+ *
+ * Receiver is notified with an event after matches are found.
+ */
+class HighlightRequest
+{
+public:
+    HighlightRequest(const QString &text, const TextMatcher &matcher, QObject *receiver)
+        : m_text(text)
+        , m_matcher(matcher)
+        , m_matches()
+        , m_mutex()
+        , m_receiver(receiver)
+        , m_finished(false)
+    {
+    }
+
+    void run()
+    {
+        m_matches = findMatches(m_text, m_matcher);
+
+        QMutexLocker lock(&m_mutex);
+        m_finished = true;
+        if (m_receiver != NULL)
+            QCoreApplication::postEvent( m_receiver, new QEvent(matchesFoundEventType()) );
+    }
+
+    /** Don't notify receiver (e.g. if it's being destroyed). */
+    void cancel()
+    {
+        QMutexLocker lock(&m_mutex);
+        m_receiver = NULL;
+    }
+
+    bool isFinished()
+    {
+        QMutexLocker lock(&m_mutex);
+        return m_finished;
+    }
+
+    /** Return found matches (call only if isFinished() is true). */
+    const TextMatches &matches() const { return m_matches; }
+
+private:
+    QString m_text;
+    TextMatcher m_matcher;
+    TextMatches m_matches;
+    QMutex m_mutex;
+    QObject *m_receiver;
+    bool m_finished;
+};
+
+typedef QSharedPointer<HighlightRequest> HighlightRequestPtr;
+
+class HighlightRunnable : public QRunnable
+{
+public:
+    explicit HighlightRunnable(const HighlightRequestPtr &request)
+        : m_request(request)
+    {
+    }
+
+    void run() { m_request->run(); }
+
+private:
+    HighlightRequestPtr m_request;
+};
+
+/**
+ * Highlights matches in QTextEdit (child object of the editor).
+ *
+ * Matches in long text are found in other thread.
+ * Found matches are cached per text and search.
+ */
+class Highlighter : public QObject
+{
+public:
+    static Highlighter *highlighter(QTextEdit *edit)
+    {
+        Highlighter *highlighter = static_cast<Highlighter*>(
+                    edit->findChild<QObject*>(highlighterObjectName) );
+        return highlighter != NULL ? highlighter : new Highlighter(edit);
+    }
+
+    ~Highlighter()
+    {
+        cancel();
+    }
+
+    void highlight(const TextMatcher &matcher, const QFont &highlightFont,
+                   const QPalette &highlightPalette)
+    {
+        cancel();
+
+        m_format = QTextCharFormat();
+        m_format.setBackground( highlightPalette.base() );
+        m_format.setForeground( highlightPalette.text() );
+        m_format.setFont(highlightFont);
+
+        if ( matcher.isEmpty() ) {
+            setMatches( TextMatches() );
+            return;
+        }
+
+        const QString text = m_edit->document()->toPlainText();
+        m_cacheKey = highlightCacheKey(text, matcher);
+
+        const TextMatches *cachedMatches = highlightCache().object(m_cacheKey);
+        if (cachedMatches != NULL) {
+            setMatches(*cachedMatches);
+        } else if (text.size() <= maxSynchronousHighlightTextLength) {
+            const TextMatches matches = findMatches(text, matcher);
+            highlightCache().insert( m_cacheKey, new TextMatches(matches) );
+            setMatches(matches);
+        } else {
+            // Clear old highlighting until matches are found.
+            setMatches( TextMatches() );
+            m_revision = m_edit->document()->revision();
+            m_request = HighlightRequestPtr( new HighlightRequest(text, matcher, this) );
+            QThreadPool::globalInstance()->start( new HighlightRunnable(m_request) );
+        }
+    }
+
+protected:
+    void customEvent(QEvent *event)
+    {
+        if ( event->type() != matchesFoundEventType() )
+            return;
+
+        // Ignore events from canceled requests.
+        if ( m_request.isNull() || !m_request->isFinished() )
+            return;
+
+        const TextMatches &matches = m_request->matches();
+        highlightCache().insert( m_cacheKey, new TextMatches(matches) );
+
+        if ( m_edit->document()->revision() == m_revision )
+            setMatches(matches);
+
+        m_request.clear();
+    }
+
+private:
+    explicit Highlighter(QTextEdit *edit)
+        : QObject(edit)
+        , m_edit(edit)
+        , m_format()
+        , m_cacheKey()
+        , m_revision(-1)
+        , m_request()
+    {
+        setObjectName(highlighterObjectName);
+    }
+
+    void cancel()
+    {
+        if ( !m_request.isNull() ) {
+            m_request->cancel();
+            m_request.clear();
+        }
+    }
+
+    void setMatches(const TextMatches &matches)
+    {
+        QList<QTextEdit::ExtraSelection> selections;
+
+        QTextDocument *doc = m_edit->document();
+        const int maxPosition = doc->characterCount() - 1;
+
+        QTextEdit::ExtraSelection selection;
+        selection.format = m_format;
+
+        foreach ( const TextMatches::value_type &match, matches ) {
+            if (match.first + match.second > maxPosition)
+                break;
+            selection.cursor = QTextCursor(doc);
+            selection.cursor.setPosition(match.first);
+            selection.cursor.setPosition(match.first + match.second, QTextCursor::KeepAnchor);
+            selections.append(selection);
+        }
+
+        m_edit->setExtraSelections(selections);
+    }
+
+    QTextEdit *m_edit;
+    QTextCharFormat m_format;
+    QString m_cacheKey;
+    int m_revision;
+    HighlightRequestPtr m_request;
+};
+
 } // namespace
 
 ItemWidget::ItemWidget(QWidget *widget)
@@ -60,7 +336,7 @@ ItemWidget::ItemWidget(QWidget *widget)
     widget->setAcceptDrops(false);
 }
 
-void ItemWidget::setHighlight(const QRegExp &re, const QFont &highlightFont,
+void ItemWidget::setHighlight(const TextMatcher &matcher, const QFont &highlightFont,
                               const QPalette &highlightPalette)
 {
     QPalette palette( widget()->palette() );
@@ -68,10 +344,10 @@ void ItemWidget::setHighlight(const QRegExp &re, const QFont &highlightFont,
     palette.setColor(QPalette::HighlightedText, highlightPalette.text().color());
     widget()->setPalette(palette);
 
-    if (m_re == re)
+    if (m_re == matcher.regExp())
         return;
-    m_re = re;
-    highlight(re, highlightFont, highlightPalette);
+    m_re = matcher.regExp();
+    highlight(matcher, highlightFont, highlightPalette);
 }
 
 QWidget *ItemWidget::createEditor(QWidget *parent) const
@@ -132,6 +408,12 @@ void ItemWidget::setCurrent(bool current)
     widget()->setAttribute(Qt::WA_TransparentForMouseEvents, !current);
 }
 
+void ItemWidget::highlightMatches(QTextEdit *edit, const TextMatcher &matcher,
+                                  const QFont &highlightFont, const QPalette &highlightPalette)
+{
+    Highlighter::highlighter(edit)->highlight(matcher, highlightFont, highlightPalette);
+}
+
 bool ItemWidget::filterMouseEvents(QTextEdit *edit, QEvent *event)
 {
     QEvent::Type type = event->type();
@@ -236,14 +518,23 @@ void ItemLoaderInterface::itemsRemovedByUser(const QList<QModelIndex> &)
 {
 }
 
+void ItemLoaderInterface::itemsAboutToBeDeleted(const QList<QModelIndex> &)
+{
+}
+
 QVariantMap ItemLoaderInterface::copyItem(const QAbstractItemModel &, const QVariantMap &itemData)
 {
     return itemData;
 }
 
-bool ItemLoaderInterface::matches(const QModelIndex &, const QRegExp &) const
+QString ItemLoaderInterface::searchableText(const QModelIndex &) const
 {
-    return false;
+    return QString();
+}
+
+QSize ItemLoaderInterface::maximumImageSize() const
+{
+    return QSize();
 }
 
 QObject *ItemLoaderInterface::tests(const TestInterfacePtr &) const
@@ -24,6 +24,7 @@
 
 #include <QRegExp>
 #include <QSharedPointer>
+#include <QSize>
 #include <QStringList>
 #include <QtPlugin>
 #include <QVariantMap>
@@ -36,9 +37,10 @@ class QModelIndex;
 class QPalette;
 class QRegExp;
 class QWidget;
+class TextMatcher;
 struct Command;
 
-#define COPYQ_PLUGIN_ITEM_LOADER_ID "org.CopyQ.ItemPlugin.ItemLoader/1.0"
+#define COPYQ_PLUGIN_ITEM_LOADER_ID "org.CopyQ.ItemPlugin.ItemLoader/2.0"
 
 #if QT_VERSION < 0x050000
 #   define Q_PLUGIN_METADATA(x)
@@ -64,7 +66,7 @@ public:
     /**
      * Set search and selections highlight color and font.
      */
-    void setHighlight(const QRegExp &re, const QFont &highlightFont,
+    void setHighlight(const TextMatcher &matcher, const QFont &highlightFont,
                       const QPalette &highlightPalette);
 
     /**
@@ -125,7 +127,16 @@ protected:
      * Highlight matching text with given font and color.
      * Default implementation does nothing.
      */
-    virtual void highlight(const QRegExp &, const QFont &, const QPalette &) {}
+    virtual void highlight(const TextMatcher &, const QFont &, const QPalette &) {}
+
+    /**
+     * Highlight text in @a edit matching @a matcher using QTextEdit::setExtraSelections().
+     *
+     * Number of highlighted matches is limited. Long text is searched in other thread
+     * and highlighted later. Matches are cached for each text and search.
+     */
+    void highlightMatches(QTextEdit *edit, const TextMatcher &matcher,
+                          const QFont &highlightFont, const QPalette &highlightPalette);
 
     /**
      * Filter mouse events for QTextEdit widgets.
@@ -273,16 +284,32 @@ public:
      */
     virtual void itemsRemovedByUser(const QList<QModelIndex> &indexList);
 
+    /**
+     * Called for all enabled plugins before items are removed from a tab
+     * (not if items are only unloaded from memory).
+     */
+    virtual void itemsAboutToBeDeleted(const QList<QModelIndex> &indexList);
+
     /**
      * Return copy of items data.
      */
     virtual QVariantMap copyItem(const QAbstractItemModel &model, const QVariantMap &itemData);
 
     /**
-     * Return true if regular expression matches items content.
-     * Returns false by default.
+     * Return text from item which should be searched when filtering items.
+     *
+     * Result is cached with the item until its data change so it should only
+     * depend on item data. Returns empty string by default.
+     */
+    virtual QString searchableText(const QModelIndex &index) const;
+
+    /**
+     * Return maximum size of images shown in items (non-positive width or height
+     * means unlimited) or invalid size if loader doesn't show images.
+     *
+     * Used to estimate size of items which were not rendered yet.
      */
-    virtual bool matches(const QModelIndex &index, const QRegExp &re) const;
+    virtual QSize maximumImageSize() const;
 
     /**
      * Return object with tests.
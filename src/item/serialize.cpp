@@ -121,7 +121,7 @@ bool deserializeDataV2(QDataStream *out, QVariantMap *data)
 
 } // namespace
 
-void serializeData(QDataStream *stream, const QVariantMap &data)
+void serializeData(QDataStream *stream, const QVariantMap &data, bool compress)
 {
     *stream << (qint32)(-2);
 
@@ -131,8 +131,8 @@ void serializeData(QDataStream *stream, const QVariantMap &data)
     QByteArray bytes;
     foreach (const QString &mime, data.keys()) {
         bytes = data[mime].toByteArray();
-        bool compress = shouldCompress(bytes, mime);
-        *stream << compressMime(mime) << compress << ( compress ? qCompress(bytes) : bytes );
+        const bool compressBytes = compress && shouldCompress(bytes, mime);
+        *stream << compressMime(mime) << compressBytes << ( compressBytes ? qCompress(bytes) : bytes );
     }
 }
 
@@ -176,11 +176,11 @@ void deserializeData(QDataStream *stream, QVariantMap *data)
     }
 }
 
-QByteArray serializeData(const QVariantMap &data)
+QByteArray serializeData(const QVariantMap &data, bool compress)
 {
     QByteArray bytes;
     QDataStream out(&bytes, QIODevice::WriteOnly);
-    serializeData(&out, data);
+    serializeData(&out, data, compress);
     return bytes;
 }
 
@@ -27,9 +27,9 @@ class QByteArray;
 class QDataStream;
 class QFile;
 
-void serializeData(QDataStream *out, const QVariantMap &data);
+void serializeData(QDataStream *out, const QVariantMap &data, bool compress = true);
 void deserializeData(QDataStream *stream, QVariantMap *data);
-QByteArray serializeData(const QVariantMap &data);
+QByteArray serializeData(const QVariantMap &data, bool compress = true);
 bool deserializeData(QVariantMap *data, const QByteArray &bytes);
 
 bool serializeData(const QAbstractItemModel &model, QDataStream *stream);
@@ -21,12 +21,16 @@
 #include "app/clipboardclient.h"
 #include "app/clipboardmonitor.h"
 #include "app/clipboardserver.h"
+#include "app/multiplexedclient.h"
+#include "common/client_server.h"
 #include "common/log.h"
 #include "platform/platformnativeinterface.h"
+#include "platform/platformwindow.h"
 #include "scriptable/scriptable.h"
 
 #include <QCoreApplication>
 #include <QFile>
+#include <QScopedPointer>
 #include <QScriptEngine>
 
 #ifdef HAS_TESTS
@@ -78,6 +82,26 @@ int startClient(int argc, char *argv[], int skipArguments, const QString &sessio
     return app.exec();
 }
 
+int activateWindow(int argc, char *argv[], const QString &serializedWindow)
+{
+    QScopedPointer<QCoreApplication> app(
+                createPlatformNativeInterface()->createClientApplication(argc, argv) );
+
+    PlatformWindowPtr window = createPlatformNativeInterface()->deserialize(
+                QByteArray::fromBase64(serializedWindow.toLatin1()) );
+    if (!window)
+        return 1;
+
+    window->raise();
+    return 0;
+}
+
+int startMultiplexedClient(int argc, char *argv[], const QString &sessionName)
+{
+    MultiplexedClient app(argc, argv, sessionName);
+    return app.exec();
+}
+
 bool needsHelp(const QString &arg)
 {
     return arg == "-h" ||
@@ -100,41 +124,6 @@ bool needsTests(const QString &arg)
 }
 #endif
 
-bool containsOnlyValidCharacters(const QString &sessionName)
-{
-    foreach (const QChar &c, sessionName) {
-        if ( !c.isLetterOrNumber() && c != '-' && c != '_' )
-            return false;
-    }
-
-    return true;
-}
-
-bool isValidSessionName(const QString &sessionName)
-{
-    return !sessionName.isNull() &&
-           sessionName.length() < 16 &&
-           containsOnlyValidCharacters(sessionName);
-}
-
-QString getSessionName(const QStringList &arguments, int *skipArguments)
-{
-    const QString firstArgument = arguments.value(0);
-    *skipArguments = 0;
-
-    if (firstArgument == "-s" || firstArgument == "--session" || firstArgument == "session") {
-        *skipArguments = 2;
-        return arguments.value(1);
-    }
-
-    if ( firstArgument.startsWith("--session=") ) {
-        *skipArguments = 1;
-        return firstArgument.mid( firstArgument.indexOf('=') + 1 );
-    }
-
-    return QString::fromUtf8( qgetenv("COPYQ_SESSION_NAME") );
-}
-
 } // namespace
 
 int main(int argc, char **argv)
@@ -178,6 +167,19 @@ int main(int argc, char **argv)
     if ( arguments.size() == 2 && arguments[0] == "monitor" )
         return startMonitor(argc, argv);
 
+    // If the only argument is "--multiplex"
+    // then run commands from standard input using single connection.
+    if ( arguments.size() - skipArguments == 1
+         && arguments[skipArguments] == multiplexedSessionArgument() )
+    {
+        return startMultiplexedClient(argc, argv, sessionName);
+    }
+
+    // If first argument is "--activate-window" (second is serialized window)
+    // then only raise the window (used by lean console client).
+    if ( arguments.size() == 2 && arguments[0] == activateWindowArgument() )
+        return activateWindow(argc, argv, arguments[1]);
+
     // If argument was specified and server is running
     // then run this process as client.
     return startClient(argc, argv, skipArguments, sessionName);
@@ -118,7 +118,8 @@ QList<CommandHelp> commandHelp()
                            Scriptable::tr("Set separator for items on output."))
                .addArg(Scriptable::tr("SEPARATOR"))
             << CommandHelp("read",
-                           Scriptable::tr("Print raw data of clipboard or item in row."))
+                           Scriptable::tr("Print raw data of clipboard or item in row.\n"
+                                          "In script, array of rows returns array with data of each item."))
                .addArg("[" + Scriptable::tr("MIME") + "|" + Scriptable::tr("ROW") + "]...")
             << CommandHelp("write", Scriptable::tr("\nWrite raw data to given row."))
                .addArg("[" + Scriptable::tr("ROW") + "=0]")
@@ -181,6 +182,12 @@ QList<CommandHelp> commandHelp()
             << CommandHelp("session, -s, --session",
                            Scriptable::tr("\nStarts or connects to application instance with given session name."))
                .addArg(Scriptable::tr("SESSION"))
+            << CommandHelp("--multiplex",
+                           Scriptable::tr("\nRun commands read from standard input using single connection.\n"
+                                          "Each command starts with line \"ID ARGC\" followed by arguments\n"
+                                          "each as line \"LENGTH\", LENGTH bytes and new line.\n"
+                                          "Responses are printed as line \"ID STATUS LENGTH\",\n"
+                                          "LENGTH bytes and new line; status other than 3 finishes the command."))
             << CommandHelp("help, -h, --help",
                            Scriptable::tr("\nPrint help for COMMAND or all commands."))
                .addArg("[" + Scriptable::tr("COMMAND") + "]...")
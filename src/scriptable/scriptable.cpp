@@ -31,6 +31,7 @@
 #include "../qt/bytearrayclass.h"
 #include "../qxt/qxtglobal.h"
 
+#include <QAtomicInt>
 #include <QApplication>
 #include <QDateTime>
 #include <QDir>
@@ -50,6 +51,12 @@ namespace {
 
 const char *const programName = "CopyQ Clipboard Manager";
 
+/// Maximum number of compiled scripts to keep for each engine.
+const int compiledScriptCacheSize = 256;
+
+QAtomicInt compiledScriptCacheHitCount;
+QAtomicInt compiledScriptCacheMissCount;
+
 QString helpHead()
 {
     return Scriptable::tr("Usage: copyq [%1]").arg(Scriptable::tr("COMMAND")) + "\n\n"
@@ -165,6 +172,8 @@ Scriptable::Scriptable(ScriptableProxy *proxy, QObject *parent)
     , m_fileClass(NULL)
     , m_inputSeparator("\n")
     , m_input()
+    , m_data()
+    , m_programs()
 {
 }
 
@@ -205,6 +214,26 @@ void Scriptable::initEngine(
     addScriptableClass(&obj, m_dirClass);
 }
 
+void Scriptable::reset(
+        ScriptableProxy *proxy, const QString &currentPath, const QVariantMap &data)
+{
+    m_proxy = proxy;
+    m_data = data;
+    m_inputSeparator = "\n";
+    m_input = QScriptValue();
+    setCurrentPath(currentPath);
+}
+
+int Scriptable::compiledScriptCacheHits()
+{
+    return compiledScriptCacheHitCount.fetchAndAddRelaxed(0);
+}
+
+int Scriptable::compiledScriptCacheMisses()
+{
+    return compiledScriptCacheMissCount.fetchAndAddRelaxed(0);
+}
+
 QScriptValue Scriptable::newByteArray(const QByteArray &bytes)
 {
     return m_baClass->newInstance(bytes);
@@ -617,13 +646,24 @@ void Scriptable::edit()
     int row;
 
     const int len = argumentCount();
+
+    // Fetch all item data at once.
+    QList<int> rows;
+    for ( int i = 0; i < len; ++i ) {
+        int itemRow;
+        if ( toInt(argument(i), itemRow) )
+            rows.append(itemRow);
+    }
+    const QVariantList itemData =
+            rows.isEmpty() ? QVariantList() : m_proxy->browserItemsFormatData(rows, mimeText);
+    int itemIndex = 0;
+
     for ( int i = 0; i < len; ++i ) {
         value = argument(i);
         if (i > 0)
             text.append( getInputSeparator() );
         if ( toInt(value, row) ) {
-            const QByteArray bytes = row >= 0 ? m_proxy->browserItemData(row, mimeText)
-                                              : m_proxy->getClipboardData(mimeText);
+            const QByteArray bytes = itemData.value(itemIndex++).toByteArray();
             text.append( QString::fromUtf8(bytes) );
         } else {
             text.append( toString(value) );
@@ -645,28 +685,44 @@ void Scriptable::edit()
 
 QScriptValue Scriptable::read()
 {
+    // Array of rows in script: read([MIME,] [ROW, ...]) returns array with data of each item.
+    if ( argumentCount() == 1 && argument(0).isArray() )
+        return readItems( mimeText, argument(0) );
+    if ( argumentCount() == 2 && argument(1).isArray() )
+        return readItems( toString(argument(0)), argument(1) );
+
     QByteArray result;
     QString mime(mimeText);
     QScriptValue value;
     QString sep = getInputSeparator();
 
-    bool used = false;
-    for ( int i = 0; i < argumentCount(); ++i ) {
-        value = argument(i);
+    // Fetch data of consecutive rows with same format at once.
+    QList<int> rows;
+    bool hasRows = false;
+    for ( int i = 0; i <= argumentCount(); ++i ) {
         int row;
-        if ( toInt(value, row) ) {
-            if (used)
-                result.append(sep);
-            used = true;
-            result.append( row >= 0 ? m_proxy->browserItemData(row, mime)
-                                    : m_proxy->getClipboardData(mime) );
-        } else {
-            mime = toString(value);
+        value = argument(i);
+        if ( i < argumentCount() && toInt(value, row) ) {
+            rows.append(row);
+            continue;
+        }
+
+        if ( !rows.isEmpty() ) {
+            foreach ( const QVariant &itemData, m_proxy->browserItemsFormatData(rows, mime) ) {
+                if (hasRows)
+                    result.append(sep);
+                result.append( itemData.toByteArray() );
+                hasRows = true;
+            }
+            rows.clear();
         }
+
+        if ( i < argumentCount() )
+            mime = toString(value);
     }
 
-    if (!used)
-        result.append( m_proxy->getClipboardData(mime) );
+    if (!hasRows)
+        return newByteArray( m_proxy->getClipboardData(mime) );
 
     return newByteArray(result);
 }
@@ -690,7 +746,7 @@ QScriptValue Scriptable::separator()
 void Scriptable::action()
 {
     QString text;
-    bool anyRows = false;
+    QList<int> rows;
     int i;
     QScriptValue value;
     QString sep = getInputSeparator();
@@ -700,15 +756,17 @@ void Scriptable::action()
         int row;
         if (!toInt(value, row))
             break;
-        if (anyRows)
-            text.append(sep);
-        else
-            anyRows = true;
-        text.append( QString::fromUtf8(m_proxy->browserItemData(row, mimeText)) );
+        rows.append(row);
     }
 
-    if (!anyRows) {
+    if ( rows.isEmpty() ) {
         text = QString::fromUtf8( m_proxy->getClipboardData(mimeText) );
+    } else {
+        QStringList texts;
+        const QVariantList items = m_proxy->browserItemsData(rows, QStringList() << mimeText);
+        foreach (const QVariant &item, items)
+            texts.append( QString::fromUtf8(item.toMap().value(mimeText).toByteArray()) );
+        text = texts.join(sep);
     }
 
     const QVariantMap data = createDataMap(mimeText, text);
@@ -778,6 +836,15 @@ QScriptValue Scriptable::eval()
 {
     const QString script = arg(0);
 
+    // Same scripts (e.g. automatic or menu commands) are usually evaluated repeatedly.
+    QScriptProgram program = m_programs.value(script);
+    if ( !program.isNull() ) {
+        compiledScriptCacheHitCount.fetchAndAddRelaxed(1);
+        return engine()->evaluate(program);
+    }
+
+    compiledScriptCacheMissCount.fetchAndAddRelaxed(1);
+
     const QScriptSyntaxCheckResult syntaxResult = engine()->checkSyntax(script);
     if (syntaxResult.state() != QScriptSyntaxCheckResult::Valid) {
         throwError( QString("Eval:%1:%2: syntax error: %3")
@@ -787,7 +854,14 @@ QScriptValue Scriptable::eval()
         return QScriptValue();
     }
 
-    return engine()->evaluate(script);
+    // Program is compiled in the engine on first evaluation.
+    // It cannot be shared with other engines since the compiled code is bound to single engine.
+    program = QScriptProgram(script);
+    if ( m_programs.size() >= compiledScriptCacheSize )
+        m_programs.clear();
+    m_programs.insert(script, program);
+
+    return engine()->evaluate(program);
 }
 
 QScriptValue Scriptable::currentpath()
@@ -952,6 +1026,42 @@ void Scriptable::setitem()
     m_proxy->browserAdd(data, row);
 }
 
+QScriptValue Scriptable::find()
+{
+    if (argumentCount() < 1 || argumentCount() > 2) {
+        throwError(argumentError());
+        return QScriptValue();
+    }
+
+    const QVariantMap options = argument(1).toVariant().toMap();
+    const QVariantMap found = m_proxy->browserFind( toString(argument(0)), options );
+    if ( found.isEmpty() )
+        return QScriptValue();
+
+    QScriptValue result = engine()->newObject();
+
+    QScriptValue rows = engine()->newArray();
+    const QVariantList rowList = found["rows"].toList();
+    for ( int i = 0; i < rowList.size(); ++i )
+        rows.setProperty( i, rowList[i].toInt() );
+    result.setProperty("rows", rows);
+
+    if ( options.contains("formats") ) {
+        QScriptValue items = engine()->newArray();
+        const QVariantList itemList = found["items"].toList();
+        for ( int i = 0; i < itemList.size(); ++i )
+            items.setProperty( i, toScriptValue(itemList[i].toMap(), this) );
+        result.setProperty("items", items);
+    }
+
+    // Row to continue search from (pass it as "offset" option to get next page).
+    const int next = found["next"].toInt();
+    if (next != -1)
+        result.setProperty("next", next);
+
+    return result;
+}
+
 QScriptValue Scriptable::tobase64()
 {
     return QString::fromLatin1(makeByteArray(argument(0)).toBase64());
@@ -1117,6 +1227,29 @@ void Scriptable::setInput(const QByteArray &bytes)
     m_input = newByteArray(bytes);
 }
 
+QScriptValue Scriptable::readItems(const QString &mime, const QScriptValue &rows)
+{
+    QList<int> rowList;
+    const quint32 len = rows.property("length").toUInt32();
+    for (quint32 i = 0; i < len; ++i) {
+        int row;
+        if ( !toInt(rows.property(i), row) ) {
+            throwError(argumentError());
+            return QScriptValue();
+        }
+        rowList.append(row);
+    }
+
+    const QVariantList itemsData =
+            rowList.isEmpty() ? QVariantList() : m_proxy->browserItemsFormatData(rowList, mime);
+
+    QScriptValue items = engine()->newArray();
+    for ( int i = 0; i < itemsData.size(); ++i )
+        items.setProperty( static_cast<quint32>(i), newByteArray(itemsData[i].toByteArray()) );
+
+    return items;
+}
+
 QList<int> Scriptable::getRows() const
 {
     QList<int> rows;
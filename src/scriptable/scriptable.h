@@ -22,9 +22,11 @@
 
 #include "scriptableproxy.h"
 
+#include <QHash>
 #include <QObject>
 #include <QString>
 #include <QScriptable>
+#include <QScriptProgram>
 #include <QScriptValue>
 
 class ByteArrayClass;
@@ -46,6 +48,18 @@ public:
     void initEngine(
             QScriptEngine *engine, const QString &currentPath, const QVariantMap &data);
 
+    /**
+     * Reset state from previous command so that already initialized engine
+     * can be reused for next command.
+     */
+    void reset(ScriptableProxy *proxy, const QString &currentPath, const QVariantMap &data);
+
+    /** Return number of evaluated scripts found in compiled script cache (in all engines). */
+    static int compiledScriptCacheHits();
+
+    /** Return number of evaluated scripts which had to be parsed (in all engines). */
+    static int compiledScriptCacheMisses();
+
     QScriptValue newByteArray(const QByteArray &bytes);
 
     QScriptValue newVariant(const QVariant &value);
@@ -176,6 +190,8 @@ public slots:
     QScriptValue getitem();
     void setitem();
 
+    QScriptValue find();
+
     QScriptValue tobase64();
     QScriptValue frombase64();
 
@@ -207,6 +223,9 @@ private:
     bool setClipboard(const QVariantMap &data, QClipboard::Mode mode);
     void changeItem(bool create);
 
+    /** Return array with data of all items in @a rows (fetched at once). */
+    QScriptValue readItems(const QString &mime, const QScriptValue &rows);
+
     ScriptableProxy *m_proxy;
     QScriptEngine *m_engine;
     ByteArrayClass *m_baClass;
@@ -215,6 +234,9 @@ private:
     QString m_inputSeparator;
     QScriptValue m_input;
     QVariantMap m_data;
+
+    /// Compiled scripts for eval() (engine is rebuilt if plugin scripts change).
+    QHash<QString, QScriptProgram> m_programs;
 };
 
 #endif // SCRIPTABLE_H
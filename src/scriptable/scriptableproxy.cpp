@@ -580,6 +580,84 @@ void ScriptableProxyHelper::browserItemData(int arg1)
     v = itemData(arg1);
 }
 
+void ScriptableProxyHelper::browserItemsData(const QList<int> &rows, const QStringList &formats)
+{
+    QVariantList items;
+
+    ClipboardBrowser *c = fetchBrowser();
+    if (c) {
+        foreach (int row, rows) {
+            const QVariantMap data = ::itemData( c->index(row) );
+            if ( formats.isEmpty() ) {
+                items.append(data);
+            } else {
+                QVariantMap item;
+                foreach (const QString &format, formats) {
+                    if ( data.contains(format) )
+                        item.insert( format, data[format] );
+                }
+                items.append(item);
+            }
+        }
+    }
+
+    v = items;
+}
+
+void ScriptableProxyHelper::browserItemsFormatData(const QList<int> &rows, const QString &mime)
+{
+    QVariantList items;
+
+    foreach (int row, rows) {
+        if (row >= 0) {
+            items.append( itemData(row, mime) );
+        } else {
+            getClipboardData(mime);
+            items.append(v);
+        }
+    }
+
+    v = items;
+}
+
+void ScriptableProxyHelper::browserFind(const QString &pattern, const QVariantMap &options)
+{
+    v = QVariant();
+
+    ClipboardBrowser *c = fetchBrowser( options.value("tab", m_tabName).toString() );
+    if (!c)
+        return;
+
+    int next;
+    const QList<int> rows = c->findItems(
+                QRegExp(pattern, Qt::CaseInsensitive),
+                options.value("offset").toInt(), options.value("limit").toInt(), &next );
+
+    const QStringList formats = options.value("formats").toStringList();
+
+    QVariantList rowList;
+    QVariantList items;
+    foreach (int row, rows) {
+        rowList.append(row);
+
+        if ( !formats.isEmpty() ) {
+            const QVariantMap data = ::itemData( c->index(row) );
+            QVariantMap item;
+            foreach (const QString &format, formats) {
+                if ( data.contains(format) )
+                    item.insert( format, data[format] );
+            }
+            items.append(item);
+        }
+    }
+
+    QVariantMap result;
+    result.insert("rows", rowList);
+    result.insert("items", items);
+    result.insert("next", next);
+    v = result;
+}
+
 void ScriptableProxyHelper::setCurrentTab(const QString &tabName)
 {
     m_tabName = tabName;
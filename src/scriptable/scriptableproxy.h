@@ -219,6 +219,10 @@ public slots:
 
     void browserItemData(int arg1, const QString &arg2);
     void browserItemData(int arg1);
+    void browserItemsData(const QList<int> &rows, const QStringList &formats);
+    void browserItemsFormatData(const QList<int> &rows, const QString &mime);
+
+    void browserFind(const QString &pattern, const QVariantMap &options);
 
     void setCurrentTab(const QString &tabName);
 
@@ -342,6 +346,15 @@ public:
 
     PROXY_METHOD_2(QByteArray, browserItemData, int, const QString &)
     PROXY_METHOD_1(QVariantMap, browserItemData, int)
+    PROXY_METHOD_2(QVariantList, browserItemsData, const QList<int> &, const QStringList &)
+
+    /**
+     * Fetch data in given format of multiple items at once to avoid waiting for main thread
+     * for each item. Clipboard data are returned for negative rows.
+     */
+    PROXY_METHOD_2(QVariantList, browserItemsFormatData, const QList<int> &, const QString &)
+
+    PROXY_METHOD_2(QVariantMap, browserFind, const QString &, const QVariantMap &)
 
     PROXY_METHOD_VOID_1(setCurrentTab, const QString &)
     PROXY_METHOD_0(QString, currentTab)
@@ -29,8 +29,11 @@
 #include "../qt/bytearrayclass.h"
 
 #include <QApplication>
+#include <QHash>
 #include <QObject>
 #include <QScriptEngine>
+#include <QScriptValueIterator>
+#include <QThreadStorage>
 
 Q_DECLARE_METATYPE(QByteArray*)
 
@@ -39,6 +42,43 @@ namespace {
 #define MONITOR_LOG(text) \
     COPYQ_LOG( QString("Script %1: %2").arg(m_id).arg(text) )
 
+/// Bigger responses are sent to client in chunks.
+const int responseChunkSize = 1024 * 1024;
+
+/// Wait for client to read data if more bytes are waiting to be sent.
+const qint64 maxPendingResponseBytes = 4 * responseChunkSize;
+
+/// Stop waiting for client which doesn't read data (e.g. output is paged).
+const int pendingResponseTimeoutMs = 10000;
+
+/**
+ * Send response in chunks (with CommandSuccess code) so client can write
+ * output incrementally. Waits for client to receive the data if it's slow.
+ *
+ * If client doesn't read the data in time, rest of the response is queued at once
+ * so stalled client doesn't block the worker thread.
+ */
+void sendResponseInChunks(ClientSocket *socket, const QByteArray &response)
+{
+    // Closed state is written in socket thread so it's checked only using thread-safe call.
+    ClientSocket::WaitResult result =
+            socket->waitForPendingBytes(maxPendingResponseBytes, pendingResponseTimeoutMs);
+
+    for ( int i = 0; i < response.size() && result != ClientSocket::WaitSocketClosed;
+          i += responseChunkSize )
+    {
+        // Blocking call ensures the chunk is counted in pending bytes (no more waiting after timeout).
+        const Qt::ConnectionType connectionType = result == ClientSocket::WaitSucceeded
+                ? Qt::BlockingQueuedConnection : Qt::QueuedConnection;
+        QMetaObject::invokeMethod( socket, "sendMessage", connectionType,
+                                   Q_ARG(QByteArray, response.mid(i, responseChunkSize)),
+                                   Q_ARG(int, CommandSuccess) );
+
+        if (result == ClientSocket::WaitSucceeded)
+            result = socket->waitForPendingBytes(maxPendingResponseBytes, pendingResponseTimeoutMs);
+    }
+}
+
 QByteArray serializeScriptValue(const QScriptValue &value)
 {
     QByteArray data;
@@ -58,6 +98,174 @@ QByteArray serializeScriptValue(const QScriptValue &value)
     return data;
 }
 
+/// Depth of objects (from global object) which are restored for each command.
+const int maxSnapshotDepth = 2;
+
+/**
+ * Script engine with initialized Scriptable object and evaluated plugin scripts.
+ *
+ * Engine is kept for each worker thread and reused by next commands
+ * until plugin scripts change.
+ *
+ * Properties of global object and of objects reachable from it in at most
+ * two steps (e.g. String.prototype, ByteArray.prototype or plugins.itemtags)
+ * are restored before each command. Changes in deeper objects and in state
+ * captured by closures of plugin scripts are kept for next commands.
+ */
+class PooledScriptEngine
+{
+public:
+    explicit PooledScriptEngine(const QString &pluginScript)
+        : m_engine()
+        , m_scriptable(NULL)
+        , m_pluginScript(pluginScript)
+        , m_snapshots()
+    {
+        m_scriptable.initEngine( &m_engine, QString(), QVariantMap() );
+
+        QObject::connect( &m_scriptable, SIGNAL(requestApplicationQuit()),
+                          qApp, SLOT(quit()) );
+
+        m_engine.evaluate(m_pluginScript);
+        m_engine.clearExceptions();
+
+        takeSnapshot( m_engine.globalObject(), 0 );
+    }
+
+    const QString &pluginScript() const { return m_pluginScript; }
+
+    QScriptEngine &engine() { return m_engine; }
+
+    Scriptable &scriptable() { return m_scriptable; }
+
+    /**
+     * Prepare engine for new command.
+     *
+     * Properties created or changed by previous command are removed or restored.
+     */
+    void reset(ScriptableProxy *proxy, const QString &currentPath, const QVariantMap &data)
+    {
+        m_engine.clearExceptions();
+
+        foreach (const ObjectSnapshot &snapshot, m_snapshots)
+            restoreSnapshot(snapshot);
+
+        m_scriptable.reset(proxy, currentPath, data);
+    }
+
+private:
+    typedef QHash<QString, QScriptValue> PropertyValues;
+
+    struct ObjectSnapshot {
+        QScriptValue object;
+        PropertyValues properties;
+    };
+
+    void takeSnapshot(const QScriptValue &object, int depth)
+    {
+        foreach (const ObjectSnapshot &snapshot, m_snapshots) {
+            if ( snapshot.object.strictlyEquals(object) )
+                return;
+        }
+
+        ObjectSnapshot snapshot;
+        snapshot.object = object;
+
+        QList<QScriptValue> children;
+        QScriptValueIterator it(object);
+        while (it.hasNext()) {
+            it.next();
+            const QScriptValue value = it.value();
+            snapshot.properties.insert( it.name(), value );
+            if ( depth < maxSnapshotDepth && value.isObject() )
+                children.append(value);
+        }
+
+        m_snapshots.append(snapshot);
+
+        foreach (const QScriptValue &child, children)
+            takeSnapshot(child, depth + 1);
+    }
+
+    static void restoreSnapshot(const ObjectSnapshot &snapshot)
+    {
+        QScriptValue object = snapshot.object;
+        QScriptValueIterator it(object);
+        while (it.hasNext()) {
+            it.next();
+            if ( it.flags() & QScriptValue::ReadOnly )
+                continue;
+
+            const PropertyValues::const_iterator property = snapshot.properties.constFind( it.name() );
+            if ( property == snapshot.properties.constEnd() )
+                it.remove();
+            else if ( !it.value().strictlyEquals(property.value()) )
+                it.setValue( property.value() );
+        }
+
+        for ( PropertyValues::const_iterator property = snapshot.properties.constBegin();
+              property != snapshot.properties.constEnd(); ++property )
+        {
+            if ( !object.property(property.key()).isValid() )
+                object.setProperty( property.key(), property.value() );
+        }
+    }
+
+    QScriptEngine m_engine;
+    Scriptable m_scriptable;
+    QString m_pluginScript;
+    QList<ObjectSnapshot> m_snapshots;
+};
+
+/// Owns engine of each worker thread (deleted when thread finishes).
+QThreadStorage<PooledScriptEngine*> pooledScriptEngines;
+
+/**
+ * Return engine for current thread.
+ * New engine is created if there is none yet or if plugin scripts changed.
+ */
+PooledScriptEngine *pooledScriptEngine(const QString &pluginScript)
+{
+    PooledScriptEngine *engine = pooledScriptEngines.localData();
+    if ( engine == NULL || engine->pluginScript() != pluginScript ) {
+        engine = new PooledScriptEngine(pluginScript);
+        pooledScriptEngines.setLocalData(engine);
+    }
+
+    return engine;
+}
+
+/**
+ * Detaches pooled Scriptable from client and command data when command ends.
+ */
+class ScriptableCommandScope
+{
+public:
+    ScriptableCommandScope(Scriptable *scriptable, ClientSocket *socket)
+        : m_scriptable(scriptable)
+        , m_socket(socket)
+    {
+    }
+
+    ~ScriptableCommandScope()
+    {
+        if (m_socket) {
+            QObject::disconnect( m_scriptable, NULL, m_socket, NULL );
+            QObject::disconnect( m_socket, NULL, m_scriptable, NULL );
+            QMetaObject::invokeMethod( m_socket, "deleteAfterDisconnected", Qt::QueuedConnection );
+        }
+
+        // Drop input sent by the client but not received by the command.
+        QCoreApplication::removePostedEvents(m_scriptable);
+
+        m_scriptable->reset( NULL, QString(), QVariantMap() );
+    }
+
+private:
+    Scriptable *m_scriptable;
+    ClientSocket *m_socket;
+};
+
 } // namespace
 
 ScriptableWorker::ScriptableWorker(MainWindow *mainWindow,
@@ -96,10 +304,13 @@ void ScriptableWorker::run()
 
     const QString currentPath = QString::fromUtf8(m_args.at(Arguments::CurrentPath));
 
-    QScriptEngine engine;
     ScriptableProxy proxy(m_wnd, data);
-    Scriptable scriptable(&proxy);
-    scriptable.initEngine(&engine, currentPath, data);
+
+    PooledScriptEngine *pooledEngine = pooledScriptEngine(m_pluginScript);
+    pooledEngine->reset(&proxy, currentPath, data);
+    QScriptEngine &engine = pooledEngine->engine();
+    Scriptable &scriptable = pooledEngine->scriptable();
+    ScriptableCommandScope commandScope(&scriptable, m_socket);
 
     if (m_socket) {
         QObject::connect( proxy.signaler(), SIGNAL(sendMessage(QByteArray,int)),
@@ -112,8 +323,6 @@ void ScriptableWorker::run()
 
         QObject::connect( m_socket, SIGNAL(disconnected()),
                           &scriptable, SLOT(abort()) );
-        QObject::connect( &scriptable, SIGNAL(destroyed()),
-                          m_socket, SLOT(deleteAfterDisconnected()) );
 
         if ( m_socket->isClosed() ) {
             MONITOR_LOG("TERMINATED");
@@ -123,9 +332,6 @@ void ScriptableWorker::run()
         m_socket->start();
     }
 
-    QObject::connect( &scriptable, SIGNAL(requestApplicationQuit()),
-                      qApp, SLOT(quit()) );
-
     QByteArray response;
     int exitCode;
 
@@ -141,6 +347,12 @@ void ScriptableWorker::run()
             scriptable.sendMessageToClient(QByteArray(), CommandFinished);
             return;
         }
+
+        if ( cmd == "compiledScriptCacheHits" && m_args.length() == Arguments::Rest + 1 ) {
+            const QByteArray hits = QByteArray::number( Scriptable::compiledScriptCacheHits() );
+            scriptable.sendMessageToClient(hits, CommandFinished);
+            return;
+        }
 #endif
 
         QScriptValue fn = engine.globalObject().property(cmd);
@@ -156,7 +368,6 @@ void ScriptableWorker::run()
             for ( int i = Arguments::Rest + 1; i < m_args.length(); ++i )
                 fnArgs.append( scriptable.newByteArray(m_args.at(i)) );
 
-            engine.evaluate(m_pluginScript);
             QScriptValue result = fn.call(QScriptValue(), fnArgs);
 
             if ( engine.hasUncaughtException() ) {
@@ -177,7 +388,14 @@ void ScriptableWorker::run()
         }
     }
 
+    if ( m_socket && exitCode == CommandFinished && response.size() > responseChunkSize ) {
+        sendResponseInChunks(m_socket, response);
+        response.clear();
+    }
+
     scriptable.sendMessageToClient(response, exitCode);
 
-    MONITOR_LOG("DONE");
+    MONITOR_LOG( QString("DONE (compiled script cache: %1 hits, %2 misses)")
+                 .arg( Scriptable::compiledScriptCacheHits() )
+                 .arg( Scriptable::compiledScriptCacheMisses() ) );
 }
@@ -29,6 +29,7 @@ HEADERS += \
     app/clipboardclient.h \
     app/clipboardmonitor.h \
     app/clipboardserver.h \
+    app/multiplexedclient.h \
     app/remoteprocess.h \
     common/action.h \
     common/arguments.h \
@@ -106,12 +107,14 @@ HEADERS += \
     scriptable/dirprototype.h \
     gui/commandaction.h \
     gui/addcommanddialog.h \
-    common/commandtester.h
+    common/commandtester.h \
+    common/textmatcher.h
 SOURCES += \
     app/app.cpp \
     app/clipboardclient.cpp \
     app/clipboardmonitor.cpp \
     app/clipboardserver.cpp \
+    app/multiplexedclient.cpp \
     app/remoteprocess.cpp \
     common/action.cpp \
     common/arguments.cpp \
@@ -182,7 +185,8 @@ SOURCES += \
     scriptable/dirprototype.cpp \
     gui/commandaction.cpp \
     gui/addcommanddialog.cpp \
-    common/commandtester.cpp
+    common/commandtester.cpp \
+    common/textmatcher.cpp
 
 macx {
     # Copy the custom Info.plist to the app bundle
@@ -24,6 +24,7 @@
 #include "common/common.h"
 #include "common/mimetypes.h"
 #include "common/monitormessagecode.h"
+#include "common/textmatcher.h"
 #include "item/itemfactory.h"
 #include "item/itemwidget.h"
 #include "item/serialize.h"
@@ -168,6 +169,27 @@ bool closeProcess(QProcess *p)
     return false;
 }
 
+/// Run lean console client (copyq-cli) in test session.
+int runConsoleClient(const QStringList &arguments, QByteArray *stdoutData, QByteArray *stderrData)
+{
+    QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
+    env.insert("COPYQ_TEST_ID", "CORE");
+
+    QProcess p;
+    p.setProcessEnvironment(env);
+    p.start( QApplication::applicationDirPath() + "/copyq-cli", arguments );
+    if ( !p.waitForStarted(10000) )
+        return -1;
+
+    p.closeWriteChannel();
+    if ( !closeProcess(&p) )
+        return -3;
+
+    *stdoutData = p.readAllStandardOutput();
+    *stderrData = p.readAllStandardError();
+    return p.exitCode();
+}
+
 /// Generate unique data.
 QByteArray generateData(const QByteArray &data)
 {
@@ -617,6 +639,7 @@ void Tests::moveAndDeleteItems()
     RUN(Args(args) << "add" << "A" << "B" << "C", "");
 
     RUN(Args(args) << "read" << "0" << "1" << "2", "C\nB\nA");
+    RUN(Args(args) << "separator" << "," << "read" << "text/plain" << "0" << "1" << "2", "C,B,A");
 
     // focus test tab by deleting (Alt+1 may not work on some systems/desktops)
     RUN(Args(args) << "keys" << "RIGHT", "");
@@ -1078,6 +1101,20 @@ void Tests::eval()
 
     TEST( m_test->runClientWithError(Args("eval") << "x", 1) );
 
+    // Repeated scripts are compiled only once in each engine
+    // (next command can run in other thread with different engine).
+    QByteArray hitsBefore;
+    TEST( m_test->getClientOutput(Args("compiledScriptCacheHits"), &hitsBefore) );
+    QByteArray hitsAfter = hitsBefore;
+    for (int i = 0; i < 10 && hitsAfter == hitsBefore; ++i) {
+        RUN(Args("eval") << "eval('print(1 + 1)')", "2");
+        TEST( m_test->getClientOutput(Args("compiledScriptCacheHits"), &hitsAfter) );
+    }
+    QVERIFY( hitsAfter.toInt() > hitsBefore.toInt() );
+
+    TEST( m_test->runClientWithError(Args("eval") << "eval('print(')", 1) );
+    TEST( m_test->runClientWithError(Args("eval") << "eval('print(')", 1) );
+
     RUN(Args("eval") << QString("tab('%1');add('abc');tab('%2');add('def');").arg(tab1).arg(tab2), "");
     RUN(Args("eval") << QString("tab('%1');if (size() === 1) print('ok')").arg(tab1), "ok");
     RUN(Args("eval") << QString("tab('%1');if (size() === 1) print('ok')").arg(tab2), "ok");
@@ -1085,6 +1122,22 @@ void Tests::eval()
     RUN(Args("eval") << QString("tab('%1');if (str(read(0)) === 'def') print('ok')").arg(tab2), "ok");
 }
 
+void Tests::evalGlobalsNotShared()
+{
+    // Script engines are reused for next commands.
+    RUN(Args("eval") << "x = 1; print = function() {}; separator('|')", "");
+    RUN(Args("eval") << "print(typeof x)", "undefined");
+    RUN(Args("eval") << "print(inputSeparator)", "\n");
+
+    // Built-in, scriptable class and plugin objects are restored too.
+    RUN(Args("eval") << "String.prototype.x = 1; ByteArray.prototype.y = 2; plugins.z = 3", "");
+    RUN(Args("eval") << "print(typeof ''.x + ' ' + typeof ByteArray.prototype.y + ' ' + typeof plugins.z)",
+        "undefined undefined undefined");
+
+    RUN(Args("eval") << "Math.max = Math.min", "");
+    RUN(Args("eval") << "print(Math.max(1, 2))", "2");
+}
+
 void Tests::rawData()
 {
     const QString tab = testTab(1);
@@ -1563,6 +1616,48 @@ void Tests::getSetItemCommands()
 
     RUN(Args(args) << "eval" << "print(getitem(1)['text/plain'])", "plain text 2");
     RUN(Args(args) << "eval" << "print(getitem(1)['text/html'])", "<b>HTML text 2</b>");
+
+    // Read many items at once.
+    const QString readItemsTab = testTab(2);
+    Args args3 = Args("tab") << readItemsTab << "add";
+    for (int i = 0; i < 100; ++i)
+        args3 << QString::number(i);
+    RUN(args3, "");
+
+    RUN(Args("tab") << readItemsTab << "eval"
+        << "var rows = []; for (var i = 0; i < 100; ++i) rows.push(i);"
+           "var items = read('text/plain', rows);"
+           "var sum = 0; for (var i = 0; i < items.length; ++i) sum += parseInt(str(items[i]));"
+           "print(items.length + ' ' + str(items[0]) + ' ' + str(items[99]) + ' ' + sum)",
+        "100 99 0 4950");
+
+    RUN(Args("tab") << readItemsTab << "eval" << "print(str(read([1, 0])[0]))", "98");
+}
+
+void Tests::findItems()
+{
+    const QString tab = testTab(1);
+    const Args args = Args("tab") << tab;
+
+    RUN(Args(args) << "add" << "a1" << "b1" << "A2" << "b2" << "a3", "");
+
+    RUN(Args(args) << "eval" << "print(find('a').rows)", "0,2,4");
+    RUN(Args(args) << "eval" << "print(find('^b').rows)", "1,3");
+    RUN(Args(args) << "eval" << "print(find('x').rows.length)", "0");
+
+    // Paging.
+    RUN(Args(args) << "eval" << "var r = find('a', {limit: 2}); print(r.rows + ';' + r.next)",
+        "0,2;3");
+    RUN(Args(args) << "eval" << "var r = find('a', {offset: 3, limit: 2}); print(r.rows + ';' + r.next)",
+        "4;undefined");
+
+    // Item data.
+    RUN(Args(args) << "eval"
+        << "var r = find('b', {formats: ['text/plain']}); print(str(r.items[0]['text/plain']) + ',' + str(r.items[1]['text/plain']))",
+        "b2,b1");
+
+    // Other tab.
+    RUN(Args() << "eval" << "print(find('b', {tab: '" + tab + "'}).rows)", "1,3");
 }
 
 void Tests::escapeHTMLCommand()
@@ -1596,6 +1691,63 @@ void Tests::executeCommand()
         , "");
 }
 
+void Tests::multiplexedSession()
+{
+    const QByteArray tab = testTab(1).toUtf8();
+    QByteArray in;
+    for (int i = 1; i <= 2; ++i) {
+        const QByteArray text = "multiplexed " + QByteArray::number(i);
+        in.append( QByteArray::number(i) + " 4\n"
+                   "3\ntab\n"
+                   + QByteArray::number(tab.size()) + "\n" + tab + "\n"
+                   "3\nadd\n"
+                   + QByteArray::number(text.size()) + "\n" + text + "\n" );
+    }
+
+    QByteArray stdoutActual;
+    QByteArray stderrActual;
+    QCOMPARE( run(Args("--multiplex"), &stdoutActual, &stderrActual, in), 0 );
+    QVERIFY2( testStderr(stderrActual), stderrActual );
+
+    // Responses can be in any order.
+    const QByteArray responses = "\n" + stdoutActual;
+    QVERIFY2( responses.contains("\n1 0 "), stdoutActual );
+    QVERIFY2( responses.contains("\n2 0 "), stdoutActual );
+
+    RUN(Args("tab") << testTab(1) << "size", "2\n");
+
+    // Malformed input results in non-zero exit code.
+    stdoutActual.clear();
+    stderrActual.clear();
+    QVERIFY( run(Args("--multiplex"), &stdoutActual, &stderrActual, "1 x\n") != 0 );
+    QVERIFY2( stderrActual.contains("Bad command header!"), stderrActual );
+
+    stdoutActual.clear();
+    stderrActual.clear();
+    QVERIFY( run(Args("--multiplex"), &stdoutActual, &stderrActual, "1 1\n10\nsize\n") != 0 );
+    QVERIFY2( stderrActual.contains("Bad command argument!"), stderrActual );
+}
+
+void Tests::consoleClient()
+{
+    const QString tab = testTab(1);
+    RUN(Args("tab") << tab << "add" << "B" << "A", "");
+
+    QByteArray stdoutActual;
+    QByteArray stderrActual;
+    QCOMPARE( runConsoleClient(Args("tab") << tab << "read" << "0" << "1", &stdoutActual, &stderrActual), 0 );
+    QVERIFY2( testStderr(stderrActual), stderrActual );
+    QCOMPARE( stdoutActual.data(), "A\nB" );
+
+    QCOMPARE( runConsoleClient(Args("tab") << tab << "add" << "C", &stdoutActual, &stderrActual), 0 );
+    QVERIFY2( testStderr(stderrActual), stderrActual );
+    RUN(Args("tab") << tab << "read" << "0", "C");
+
+    // Exit code and error of failed command are passed from server.
+    QCOMPARE( runConsoleClient(Args("xxx"), &stdoutActual, &stderrActual), 1 );
+    QVERIFY2( stderrActual.contains("xxx"), stderrActual );
+}
+
 int Tests::run(const QStringList &arguments, QByteArray *stdoutData, QByteArray *stderrData, const QByteArray &in)
 {
     return m_test->run(arguments, stdoutData, stderrData, in);
@@ -1648,3 +1800,74 @@ int runTests(int argc, char *argv[])
 
     return exitCode;
 }
+
+void Tests::textMatcher()
+{
+    // Long texts use vectorized search (if available) for blocks of characters.
+    const QString prefix = QString("x").repeated(37);
+    const QString text = prefix + QString::fromUtf8("Abc \xc5\xbftraße abc");
+
+    const TextMatcher caseSensitive( QRegExp("abc") );
+    QVERIFY( caseSensitive.isLiteral() );
+    QCOMPARE( caseSensitive.indexIn(text), prefix.size() + 11 );
+    QCOMPARE( caseSensitive.indexIn(text, prefix.size() + 12), -1 );
+
+    int length = 0;
+    const TextMatcher caseInsensitive( QRegExp("ABC", Qt::CaseInsensitive) );
+    QVERIFY( caseInsensitive.isLiteral() );
+    QCOMPARE( caseInsensitive.indexIn(text, 0, &length), prefix.size() );
+    QCOMPARE( length, 3 );
+    QCOMPARE( caseInsensitive.indexIn(text, prefix.size() + 1), prefix.size() + 11 );
+
+    // ASCII needle matches non-ASCII character which folds to it.
+    const TextMatcher asciiNeedle( QRegExp("STRA", Qt::CaseInsensitive) );
+    QVERIFY( asciiNeedle.isLiteral() );
+    QCOMPARE( asciiNeedle.indexIn(text), prefix.size() + 4 );
+
+    // Non-ASCII first character can match ASCII character if case is ignored.
+    const TextMatcher nonAsciiNeedle(
+                QRegExp(QString::fromUtf8("\xc5\xbftra"), Qt::CaseInsensitive) );
+    QVERIFY( !nonAsciiNeedle.isLiteral() );
+#ifdef COPYQ_TEXTMATCHER_PCRE
+    QVERIFY( nonAsciiNeedle.matches(prefix + "Stra") );
+#endif
+
+    const TextMatcher regExp( QRegExp("a.c", Qt::CaseInsensitive) );
+    QVERIFY( !regExp.isLiteral() );
+    QCOMPARE( regExp.indexIn(text), prefix.size() );
+    QVERIFY( TextMatcher(QRegExp()).matches(text) );
+}
+
+void Tests::textMatcherBenchmark_data()
+{
+    QTest::addColumn<bool>("literal");
+
+    QTest::newRow("TextMatcher") << true;
+    QTest::newRow("QRegExp") << false;
+}
+
+void Tests::textMatcherBenchmark()
+{
+    QFETCH(bool, literal);
+
+    // Large text with many near matches and single match at the end.
+    QString text;
+    const QString words[] = { "lorem ", "Ipsum ", "dolor ", "SIT ", "amet\n", "copy " };
+    for (int i = 0; text.size() < 4 * 1024 * 1024; ++i)
+        text.append( words[(i * 7 + i / 3) % 6] );
+    text.append("copyq");
+
+    const QRegExp re("COPYQ", Qt::CaseInsensitive);
+    const TextMatcher matcher(re);
+    QVERIFY( matcher.isLiteral() );
+
+    int i = -1;
+    if (literal) {
+        QBENCHMARK { i = matcher.indexIn(text); }
+    } else {
+        QRegExp re2(re);
+        QBENCHMARK { i = re2.indexIn(text); }
+    }
+
+    QCOMPARE( i, text.size() - 5 );
+}
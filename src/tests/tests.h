@@ -66,6 +66,7 @@ private slots:
     void importExportTab();
     void separator();
     void eval();
+    void evalGlobalsNotShared();
     void rawData();
 
     void nextPrevious();
@@ -91,10 +92,21 @@ private slots:
     void base64Commands();
     void getSetItemCommands();
 
+    void findItems();
+
     void escapeHTMLCommand();
 
     void executeCommand();
 
+    void multiplexedSession();
+
+    void consoleClient();
+
+    void textMatcher();
+
+    void textMatcherBenchmark_data();
+    void textMatcherBenchmark();
+
 private:
     void clearServerErrors();
     int run(const QStringList &arguments, QByteArray *stdoutData = NULL,